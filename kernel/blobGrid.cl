@@ -0,0 +1,49 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#ifndef CL_VERSION_1_0
+#include "clstd.h"
+#define GRID_CAPACITY 32
+#endif
+
+typedef struct __attribute__ ((packed)) {
+	uchar r;
+	uchar g;
+	uchar b;
+} RGB;
+
+typedef struct __attribute__ ((packed)) {
+	float x, y;
+	RGB color;
+	RGB center;
+	float circ;
+	float score;
+} Match;
+
+// Sorts the matches of blobList into a uniform grid with GRID_CAPACITY slots per cell, cellCounts has to be zeroed.
+// Counts above GRID_CAPACITY mark overflowed cells.
+kernel void blobGrid(global const Match* matches, global const int* counter, global volatile int* cellCounts, global int* cells, const float cellSize, const int gridWidth, const int gridHeight, const int maxMatches) {
+	const int i = get_global_id(0);
+	if(i >= min(counter[0], maxMatches))
+		return;
+
+	const int x = clamp((int)(matches[i].x / cellSize), 0, gridWidth-1);
+	const int y = clamp((int)(matches[i].y / cellSize), 0, gridHeight-1);
+	const int cell = x + y*gridWidth;
+
+	const int slot = atomic_inc(cellCounts + cell);
+	if(slot < GRID_CAPACITY)
+		cells[cell*GRID_CAPACITY + slot] = i;
+}
@@ -15,6 +15,8 @@
  */
 #ifndef CL_VERSION_1_0
 #include "clstd.h"
+#define DISC_SIZE 1
+#define MASK_TILE 16
 #endif
 
 typedef struct __attribute__ ((packed)) {
@@ -33,8 +35,17 @@ typedef struct __attribute__ ((packed)) {
 
 const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
 
-kernel void matches(read_only image2d_t img, read_only image2d_t circ, global Match* matches, global volatile int* counter, const float circThreshold, const float minScore, const int radius, const int maxMatches) {
+// Processing mask with one entry per MASK_TILE x MASK_TILE tile, set by the host
+inline bool tileActive(global const uchar* mask, const int2 pos, const int width) {
+	return mask[pos.y/MASK_TILE * ((width + MASK_TILE - 1) / MASK_TILE) + pos.x/MASK_TILE];
+}
+
+// disc contains the DISC_SIZE pixel offsets within the blob radius, both derived from the geometry by the host
+kernel void matches(read_only image2d_t img, read_only image2d_t circ, global Match* matches, global volatile int* counter, constant int2* disc, global const uchar* mask, const float circThreshold, const float minScore, const int maxMatches) {
 	const int2 pos = (int2)(get_global_id(0), get_global_id(1));
+	if(!tileActive(mask, pos, get_image_width(circ)))
+		return;
+
 	float circScore = read_imagef(circ, sampler, pos).x;
 	if(circScore < circThreshold)
 		return;
@@ -55,21 +66,14 @@ kernel void matches(read_only image2d_t img, read_only image2d_t circ, global Ma
 	}
 
 	//https://en.wikipedia.org/wiki/Standard_deviation#Rapid_calculation_methods
-	int n = 0;
+	const int n = DISC_SIZE;
 	uint4 s1 = (uint4)(0, 0, 0, 0);
 	uint4 s2 = (uint4)(0, 0, 0, 0); // Value estimation (255*255) * (16*16) /256^4 (far in range of uint)
-	{
-		const int sqRadius = radius*radius;
-		for(int y = -radius; y <= radius; y++) {
-			for(int x = -radius; x <= radius; x++) {
-				if(x*x + y*y <= sqRadius) {
-					uint4 v = read_imageui(img, sampler, pos + (int2)(x, y));
-					s1 += v;
-					s2 += v*v;
-					n++; //TODO faster by computation? -> https://mathworld.wolfram.com/GausssCircleProblem.html
-				}
-			}
-		}
+#pragma unroll
+	for(int i = 0; i < DISC_SIZE; i++) {
+		uint4 v = read_imageui(img, sampler, pos + disc[i]);
+		s1 += v;
+		s2 += v*v;
 	}
 
 	//https://en.wikipedia.org/wiki/Summed-area_table
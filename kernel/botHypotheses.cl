@@ -0,0 +1,210 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#ifndef CL_VERSION_1_0
+#include "clstd.h"
+#define GRID_CAPACITY 32
+#define MAX_NEIGHBOURS 32
+#endif
+
+typedef struct __attribute__ ((packed)) {
+	uchar r;
+	uchar g;
+	uchar b;
+} RGB;
+
+typedef struct __attribute__ ((packed)) {
+	float x, y;
+	RGB color;
+	RGB center;
+	float circ;
+	float score;
+} Match;
+
+typedef struct __attribute__ ((packed)) {
+	int blobs[5]; // match indices, center blob first
+	float score;  // 0: no hypothesis, -1: too many neighbours, has to be searched on the host
+} BotMatch;
+
+// Same as pattern.h
+constant float patternAnglesb2b[25] = {
+		 0.        , -2.13940875, -0.56861242,  0.56861242,  2.13940875,
+		 1.00218391,  0.        ,  0.21678574,  0.78539816,  1.57079633,
+		 2.57298023, -2.92480691,  0.        ,  1.57079633,  2.35619449,
+		-2.57298023, -2.35619449, -1.57079633,  0.        ,  2.92480691,
+		-1.00218391, -1.57079633, -0.78539816, -0.21678574,  0.
+};
+
+constant float2 patternPos[5] = {
+		(float2)(  0.f   ,   0.f   ),
+		(float2)( 35.f   ,  54.772f),
+		(float2)(-54.772f,  35.f   ),
+		(float2)(-54.772f, -35.f   ),
+		(float2)( 35.f   , -54.772f)
+};
+
+inline float ccwGap(const float from, const float to) {
+	const float gap = to - from;
+	return gap < 0.0f ? gap + 2.0f * M_PI_F : gap;
+}
+
+inline float2 rotate(const float2 v, const float s, const float c) {
+	return (float2)(c*v.x - s*v.y, s*v.x + c*v.y);
+}
+
+// BotGeometryBatch::evaluate for a complete pattern
+inline float offsetScore(const float2* blobs) {
+	float oSin = 0.0f;
+	float oCos = 0.0f;
+	for(int a = 0; a < 5; a++) {
+		for(int b = a+1; b < 5; b++) {
+			const float2 diff = blobs[b] - blobs[a];
+			const float sqLength = dot(diff, diff);
+			if(sqLength == 0.0f)
+				continue;
+
+			float pCos;
+			const float pSin = sincos(patternAnglesb2b[b*5 + a], &pCos);
+			const float2 direction = rotate(diff, -pSin, pCos) / sqrt(sqLength);
+			oSin += direction.y;
+			oCos += direction.x;
+		}
+	}
+
+	const float sqLength = oSin*oSin + oCos*oCos;
+	const float s = sqLength > 0.0f ? oSin / sqrt(sqLength) : 0.0f;
+	const float c = sqLength > 0.0f ? oCos / sqrt(sqLength) : 1.0f;
+	float2 pos = (float2)(0.0f, 0.0f);
+	for(int i = 0; i < 5; i++)
+		pos += blobs[i] - rotate(patternPos[i], s, c);
+	pos /= 5.0f;
+
+	float score = 1.0f;
+	for(int i = 0; i < 5; i++) {
+		const float2 offset = (blobs[i] - (pos + rotate(patternPos[i], s, c))) / 10.0f; // (10.0f) 1cm offset -> 0.5 score
+		score = min(score, 1.0f / (1.0f + dot(offset, offset)));
+	}
+	return score;
+}
+
+// Best pattern quadruple around every match like PatternMatcher::match, positions in mm relative to the flat image origin.
+// tolerance and gapTolerance are the distance and angular gap bounds for min_confidence derived by the host.
+kernel void botHypotheses(global const Match* matches, global const int* counter, global const int* cellCounts, global const int* cells, global BotMatch* out, const float cellSize, const int gridWidth, const int gridHeight, const float fieldScale, const float maxRobotRadius, const float tolerance, const float gapTolerance, const int maxMatches) {
+	const int i = get_global_id(0);
+	if(i >= min(counter[0], maxMatches))
+		return;
+
+	global BotMatch* result = out + i;
+	result->score = -1.0f;
+
+	const float2 center = (float2)(matches[i].x, matches[i].y) * fieldScale;
+	const float sideDistance = length(patternPos[1]);
+
+	float angles[MAX_NEIGHBOURS];
+	float2 positions[MAX_NEIGHBOURS];
+	int indices[MAX_NEIGHBOURS];
+	int n = 0;
+
+	const int cx = clamp((int)(matches[i].x / cellSize), 0, gridWidth-1);
+	const int cy = clamp((int)(matches[i].y / cellSize), 0, gridHeight-1);
+	for(int y = max(cy-1, 0); y <= min(cy+1, gridHeight-1); y++) {
+		for(int x = max(cx-1, 0); x <= min(cx+1, gridWidth-1); x++) {
+			const int cell = x + y*gridWidth;
+			const int count = cellCounts[cell];
+			if(count > GRID_CAPACITY)
+				return;
+
+			for(int k = 0; k < count; k++) {
+				const int j = cells[cell*GRID_CAPACITY + k];
+				const float2 pos = (float2)(matches[j].x, matches[j].y) * fieldScale;
+				const float2 diff = pos - center;
+				const float distance = length(diff);
+				if(distance > maxRobotRadius || fabs(distance - sideDistance) >= tolerance)
+					continue;
+
+				if(n == MAX_NEIGHBOURS)
+					return;
+
+				// Insertion sort by angle
+				const float angle = atan2(diff.y, diff.x);
+				int p = n++;
+				for(; p > 0 && angles[p-1] > angle; p--) {
+					angles[p] = angles[p-1];
+					positions[p] = positions[p-1];
+					indices[p] = indices[p-1];
+				}
+				angles[p] = angle;
+				positions[p] = pos;
+				indices[p] = j;
+			}
+		}
+	}
+
+	float patternDistances[5][5];
+	for(int a = 0; a < 5; a++)
+		for(int b = 0; b < 5; b++)
+			patternDistances[a][b] = distance(patternPos[a], patternPos[b]);
+
+	float patternGaps[4];
+	for(int a = 0; a < 4; a++)
+		patternGaps[a] = ccwGap(atan2(patternPos[a+1].y, patternPos[a+1].x), atan2(patternPos[(a+1)%4 + 1].y, patternPos[(a+1)%4 + 1].x));
+
+#define FITS(a, b, i, j) (fabs(distance(positions[a], positions[b]) - patternDistances[i][j]) < tolerance)
+#define GAP_FITS(a, b, i) (fabs(remainder(ccwGap(angles[a], angles[b]) - patternGaps[i], 2.0f * M_PI_F)) < gapTolerance)
+
+	float bestScore = 0.0f;
+	int best[4];
+	float2 blobs[5];
+	blobs[0] = center;
+	for(int a = 0; a < n; a++) {
+		for(int b = a+1; b < a+n-2; b++) {
+			const int bi = b%n;
+			if(!FITS(a, bi, 1, 2) || !GAP_FITS(a, bi, 0))
+				continue;
+
+			for(int c = b+1; c < a+n-1; c++) {
+				const int ci = c%n;
+				if(!FITS(bi, ci, 2, 3) || !FITS(a, ci, 1, 3) || !GAP_FITS(bi, ci, 1))
+					continue;
+
+				for(int d = c+1; d < a+n; d++) {
+					const int di = d%n;
+					if(!FITS(ci, di, 3, 4) || !FITS(a, di, 1, 4) || !FITS(bi, di, 2, 4) || !GAP_FITS(ci, di, 2) || !GAP_FITS(di, a, 3))
+						continue;
+
+					blobs[1] = positions[a];
+					blobs[2] = positions[bi];
+					blobs[3] = positions[ci];
+					blobs[4] = positions[di];
+					const float score = offsetScore(blobs);
+					if(score > bestScore) {
+						bestScore = score;
+						best[0] = indices[a];
+						best[1] = indices[bi];
+						best[2] = indices[ci];
+						best[3] = indices[di];
+					}
+				}
+			}
+		}
+	}
+
+	result->score = bestScore;
+	if(bestScore > 0.0f) {
+		result->blobs[0] = i;
+		for(int k = 0; k < 4; k++)
+			result->blobs[k+1] = best[k];
+	}
+}
@@ -0,0 +1,90 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#ifndef CL_VERSION_1_0
+#include "clstd.h"
+#define BLOB_RADIUS 1
+#define TILE 16
+#endif
+
+const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
+
+#define SIZE (TILE + 2*BLOB_RADIUS)
+
+//Same quadrants as satBlobCenter.cl circle, but summed directly as separable box filters in local memory:
+//positive quadrant side covers offsets [2, BLOB_RADIUS], negative side [-BLOB_RADIUS+1, -1]
+//BLOB_RADIUS is derived from the geometry by the host, the work group size has to be TILE x TILE
+//TILE equals the processing mask tile size, inactive work groups exit as a whole before the first barrier
+kernel __attribute__((reqd_work_group_size(TILE, TILE, 1))) void box(read_only image2d_t gradDot, write_only image2d_t out, global const uchar* mask) {
+	local float px[SIZE][SIZE];
+	local float hPos[SIZE][TILE];
+	local float hNeg[SIZE][TILE];
+
+	const int lx = get_local_id(0);
+	const int ly = get_local_id(1);
+	const int2 pos = (int2)(get_global_id(0), get_global_id(1));
+	const bool inside = pos.x < get_image_width(out) && pos.y < get_image_height(out);
+	if(!mask[get_group_id(1) * get_num_groups(0) + get_group_id(0)]) {
+		if(inside)
+			write_imagef(out, pos, 0.0f);
+		return;
+	}
+
+	const int2 origin = (int2)(get_group_id(0)*TILE - BLOB_RADIUS, get_group_id(1)*TILE - BLOB_RADIUS);
+
+	for(int y = ly; y < SIZE; y += TILE)
+		for(int x = lx; x < SIZE; x += TILE)
+			px[y][x] = read_imagef(gradDot, sampler, origin + (int2)(x, y)).x;
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	for(int y = ly; y < SIZE; y += TILE) {
+		const int x = lx + BLOB_RADIUS;
+		float right = 0.0f;
+		float left = 0.0f;
+#pragma unroll
+		for(int d = 2; d <= BLOB_RADIUS; d++)
+			right += px[y][x + d];
+#pragma unroll
+		for(int d = 1; d < BLOB_RADIUS; d++)
+			left += px[y][x - d];
+
+		hPos[y][lx] = right;
+		hNeg[y][lx] = left;
+	}
+
+	barrier(CLK_LOCAL_MEM_FENCE);
+
+	const int y = ly + BLOB_RADIUS;
+	float ppScore = 0.0f;
+	float npScore = 0.0f;
+	float pnScore = 0.0f;
+	float nnScore = 0.0f;
+#pragma unroll
+	for(int d = 2; d <= BLOB_RADIUS; d++) {
+		ppScore += hPos[y + d][lx];
+		npScore += hNeg[y + d][lx];
+	}
+#pragma unroll
+	for(int d = 1; d < BLOB_RADIUS; d++) {
+		pnScore += hPos[y - d][lx];
+		nnScore += hNeg[y - d][lx];
+	}
+
+	if(!inside)
+		return;
+
+	write_imagef(out, pos, min(min(ppScore, nnScore), min(-pnScore, -npScore)) / (BLOB_RADIUS*BLOB_RADIUS));
+}
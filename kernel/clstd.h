@@ -29,9 +29,13 @@
 #define CLK_ADDRESS_CLAMP 3
 #define CLK_FILTER_LINEAR 4
 #define CLK_FILTER_NEAREST 5
+#define CLK_LOCAL_MEM_FENCE 1
 
 typedef unsigned char uchar;
 typedef struct { uchar x, y, z; } uchar3;
+typedef struct { uchar x, y, z, w; } uchar4;
+typedef struct { uchar s0, s1, s2, s3, s4, s5, s6, s7; } uchar8;
+typedef struct { uchar s0, s1, s2, s3, s4, s5, s6, s7, s8, s9, sa, sb, sc, sd, se, sf; } uchar16;
 typedef unsigned int uint;
 typedef struct { int x, y; } int2;
 typedef struct { float x, y; } float2;
@@ -55,6 +59,9 @@ void write_imagef(image2d_t, int2, float);
 
 int get_global_id(int);
 int get_global_size(int);
+int get_local_id(int);
+int get_group_id(int);
+int get_num_groups(int);
 int get_image_width(image2d_t);
 int get_image_height(image2d_t);
 
@@ -65,6 +72,7 @@ bool isnan(float);
 
 float native_sqrt(float);
 float4 native_sqrt(float4);
+float sqrt(float);
 char convert_char_sat(float);
 uchar convert_uchar_sat(float);
 int4 convert_int4(uint4);
@@ -76,8 +84,25 @@ float4 convert_float4(uint4);
 int abs(int);
 float fabs(float);
 float round(float);
+int clamp(int, int, int);
+float min(float, float);
+float atan2(float, float);
+float sincos(float, float*);
+float remainder(float, float);
+float length(float2);
+float distance(float2, float2);
+float dot(float2, float2);
 
 int atomic_inc(volatile global int*);
+void barrier(int);
 
+uchar4 vload4(int, const uchar*);
+uchar8 vload8(int, const uchar*);
+uchar16 vload16(int, const uchar*);
+void vstore4(uchar4, int, uchar*);
+void vstore8(uchar8, int, uchar*);
+void vstore16(uchar16, int, uchar*);
+
+#define M_PI_F 3.14159274f
 #define INFINITY 9999999999999.9f
 #define NAN 9999999999999.9f
@@ -17,11 +17,14 @@
 #include "clstd.h"
 #endif
 
-const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE;
+const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
 
-void kernel f2nv12(read_only image2d_t in, global uchar* out) {
+// Iterates over the output pixels, the input is fit into the output by scale and offset (see Resources::streamMapping)
+void kernel f2nv12(read_only image2d_t in, global uchar* out, const float scale, const float offsetX, const float offsetY) {
 	int2 pos = (int2)(get_global_id(0), get_global_id(1));
+	const float2 src = ((float2)(pos.x, pos.y) + 0.5f) * scale + (float2)(offsetX, offsetY);
+	const bool inside = src.x >= 0.0f && src.y >= 0.0f && src.x < get_image_width(in) && src.y < get_image_height(in);
 
-	out[pos.x + pos.y*get_global_size(0)] = convert_uchar_sat(read_imagef(in, sampler, pos).x + 127);
-	out[get_image_width(in)*get_image_height(in) + pos.x + (pos.y/2)*get_global_size(0)] = 127;
+	out[pos.x + pos.y*get_global_size(0)] = inside ? convert_uchar_sat(read_imagef(in, sampler, src).x + 127) : 16;
+	out[get_global_size(0)*get_global_size(1) + pos.x + (pos.y/2)*get_global_size(0)] = 127;
 }
\ No newline at end of file
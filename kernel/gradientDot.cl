@@ -15,12 +15,26 @@
  */
 #ifndef CL_VERSION_1_0
 #include "clstd.h"
+#define GRADIENT_OFFSET 1
+#define MASK_TILE 16
 #endif
 
 const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
 
-kernel void gradient_dotproduct(read_only image2d_t in, write_only image2d_t out, int offset) {
+// Processing mask with one entry per MASK_TILE x MASK_TILE tile, set by the host
+inline bool tileActive(global const uchar* mask, const int2 pos, const int width) {
+	return mask[pos.y/MASK_TILE * ((width + MASK_TILE - 1) / MASK_TILE) + pos.x/MASK_TILE];
+}
+
+// GRADIENT_OFFSET is derived from the geometry by the host
+kernel void gradient_dotproduct(read_only image2d_t in, write_only image2d_t out, global const uchar* mask) {
 	const int2 pos = (int2)(get_global_id(0), get_global_id(1));
+	if(!tileActive(mask, pos, get_image_width(out))) {
+		write_imagef(out, pos, 0.0f);
+		return;
+	}
+
+	const int offset = GRADIENT_OFFSET;
 
 	float4 gx = convert_float4(read_imageui(in, sampler, (int2)(pos.x+offset, pos.y))) - convert_float4(read_imageui(in, sampler, (int2)(pos.x-offset, pos.y)));
 	float4 gy = convert_float4(read_imageui(in, sampler, (int2)(pos.x, pos.y+offset))) - convert_float4(read_imageui(in, sampler, (int2)(pos.x, pos.y-offset)));
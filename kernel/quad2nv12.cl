@@ -20,40 +20,45 @@
 
 const sampler_t sampler = CLK_FILTER_LINEAR | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
 
-kernel void quad2nv12(read_only image2d_t channel0, read_only image2d_t channel1, read_only image2d_t channel2, read_only image2d_t channel3, global uchar* out) {
+// Iterates over the output pixels, the input is fit into the output by scale and offset (see Resources::streamMapping)
+kernel void quad2nv12(read_only image2d_t channel0, read_only image2d_t channel1, read_only image2d_t channel2, read_only image2d_t channel3, global uchar* out, const float scale, const float offsetX, const float offsetY) {
 	int2 pos = (int2)(get_global_id(0), get_global_id(1));
+	const float2 src = ((float2)(pos.x, pos.y) + 0.5f) * scale - 0.5f + (float2)(offsetX, offsetY);
+	const bool inside = src.x > -0.5f && src.y > -0.5f && src.x < get_image_width(channel0) - 0.5f && src.y < get_image_height(channel0) - 0.5f;
 
 #ifdef BGR
 	uint4 color = (uint4)(
-			read_imageui(channel2, sampler, pos).x,
-			read_imageui(channel1, sampler, pos).x,
-			read_imageui(channel0, sampler, pos).x,
+			read_imageui(channel2, sampler, src).x,
+			read_imageui(channel1, sampler, src).x,
+			read_imageui(channel0, sampler, src).x,
 			255
 	);
 #endif
 
 #ifdef RGGB
 	uint4 color = (uint4)(
-			read_imageui(channel0, sampler, (float2)(pos.x + 0.25f, pos.y + 0.25f)).x,
-			read_imageui(channel1, sampler, (float2)(pos.x - 0.25f, pos.y + 0.25f)).x/2 + read_imageui(channel2, sampler, (float2)(pos.x + 0.25f, pos.y - 0.25f)).x/2,
-			read_imageui(channel3, sampler, (float2)(pos.x - 0.25f, pos.y - 0.25f)).x,
+			read_imageui(channel0, sampler, (float2)(src.x + 0.25f, src.y + 0.25f)).x,
+			read_imageui(channel1, sampler, (float2)(src.x - 0.25f, src.y + 0.25f)).x/2 + read_imageui(channel2, sampler, (float2)(src.x + 0.25f, src.y - 0.25f)).x/2,
+			read_imageui(channel3, sampler, (float2)(src.x - 0.25f, src.y - 0.25f)).x,
 			255
 	);
 #endif
 
 #ifdef GRBG
 	uint4 color = (uint4)(
-			read_imageui(channel1, sampler, (float2)(pos.x - 0.25f, pos.y + 0.25f)).x,
-			read_imageui(channel0, sampler, (float2)(pos.x + 0.25f, pos.y + 0.25f)).x/2 + read_imageui(channel3, sampler, (float2)(pos.x - 0.25f, pos.y - 0.25f)).x/2,
-			read_imageui(channel2, sampler, (float2)(pos.x + 0.25f, pos.y - 0.25f)).x,
+			read_imageui(channel1, sampler, (float2)(src.x - 0.25f, src.y + 0.25f)).x,
+			read_imageui(channel0, sampler, (float2)(src.x + 0.25f, src.y + 0.25f)).x/2 + read_imageui(channel3, sampler, (float2)(src.x - 0.25f, src.y - 0.25f)).x/2,
+			read_imageui(channel2, sampler, (float2)(src.x + 0.25f, src.y - 0.25f)).x,
 			255
 	);
 #endif
+	// Letterbox outside of the input
+	color = inside ? color : (uint4)(0, 0, 0, 255);
 
 	out[pos.x + pos.y*get_global_size(0)] = convert_uchar_sat((66*color.r + 129*color.g + 25*color.b) / 256 + 16);
 
 	pos /= 2;
-	const int uvout = get_image_width(channel0)*get_image_height(channel0) + pos.x*2 + pos.y*get_global_size(0);
+	const int uvout = get_global_size(0)*get_global_size(1) + pos.x*2 + pos.y*get_global_size(0);
 	out[uvout] = convert_uchar_sat((-38*(int)color.r + -74*(int)color.g + 112*(int)color.b) / 256 + 128);
 	out[uvout+1] = convert_uchar_sat((112*(int)color.r + -94*(int)color.g + -18*(int)color.b) / 256 + 128);
 }
\ No newline at end of file
@@ -17,23 +17,90 @@
 #include "clstd.h"
 #endif
 
+// Output pixels per work-item, set by the host
+#ifndef RUN
+#define RUN 8
+#endif
+
+// Bytes of one raw image row covering n output pixels
+#ifdef BGR
+#define ROW_BYTES(n) (3*(n))
+#elif defined PACKED10
+#define ROW_BYTES(n) ((5*(n)+1)/2)
+#elif defined PACKED12
+#define ROW_BYTES(n) (3*(n))
+#else
+#define ROW_BYTES(n) (2*(n))
+#endif
+
+#define RUN_BYTES ROW_BYTES(RUN)
+
+// Wide load of a full run, scalar fallback for the image border
+inline void loadRun(global const uchar* src, uchar* dst, const int bytes) {
+	if(bytes == RUN_BYTES) {
+		vstore16(vload16(0, src), 0, dst);
+#if RUN_BYTES == 20
+		vstore4(vload4(0, src + 16), 0, dst + 16);
+#elif RUN_BYTES == 24
+		vstore8(vload8(0, src + 16), 0, dst + 16);
+#endif
+		return;
+	}
+
+	for(int i = 0; i < bytes; i++)
+		dst[i] = src[i];
+}
+
+// i-th sensor sample of a row reduced to its 8 most significant bits
+// https://www.emva.org/wp-content/uploads/GenICam_PFNC_2_4.pdf (LSB packed 10p/12p layout)
+inline uint sample(const uchar* row, const int i) {
+#if defined PACKED10
+	const uchar* b = row + 5*(i/4);
+	switch(i % 4) {
+		case 0: return (uchar)((b[0] >> 2) | (b[1] << 6));
+		case 1: return (uchar)((b[1] >> 4) | (b[2] << 4));
+		case 2: return (uchar)((b[2] >> 6) | (b[3] << 2));
+		default: return b[4];
+	}
+#elif defined PACKED12
+	const uchar* b = row + 3*(i/2);
+	return i % 2 ? b[2] : (uchar)((b[0] >> 4) | (b[1] << 4));
+#else
+	return row[i];
+#endif
+}
 
 kernel void raw2quad(global const uchar* img, write_only image2d_t channel0, write_only image2d_t channel1, write_only image2d_t channel2, write_only image2d_t channel3) {
-	const int2 pos = (int2)(get_global_id(0), get_global_id(1));
+	const int width = get_image_width(channel0);
+	const int x0 = get_global_id(0) * RUN;
+	const int y = get_global_id(1);
+	const int run = min(RUN, width - x0);
 
 #ifdef BGR
-	const int imgpos = 3*(pos.x + pos.y*get_global_size(0));
+	uchar row[RUN_BYTES];
+	loadRun(img + ROW_BYTES(x0 + y*width), row, ROW_BYTES(run));
 
-	write_imageui(channel0, pos, img[imgpos]);
-	write_imageui(channel1, pos, img[imgpos+1]);
-	write_imageui(channel2, pos, img[imgpos+2]);
+	for(int i = 0; i < run; i++) {
+		const int2 pos = (int2)(x0 + i, y);
+		write_imageui(channel0, pos, row[3*i]);
+		write_imageui(channel1, pos, row[3*i+1]);
+		write_imageui(channel2, pos, row[3*i+2]);
+	}
 #elif defined RGGB || defined GRBG
-	const int row_size = 2*get_global_size(0);
-	const int imgpos = 2*pos.x + 2*pos.y*row_size;
+	const int rowSize = ROW_BYTES(width);
+	const int imgpos = 2*y*rowSize + ROW_BYTES(x0);
+
+	uchar even[RUN_BYTES];
+	uchar odd[RUN_BYTES];
+	loadRun(img + imgpos, even, ROW_BYTES(run));
+	loadRun(img + imgpos + rowSize, odd, ROW_BYTES(run));
 
-	write_imageui(channel0, pos, img[imgpos]);
-	write_imageui(channel1, pos, img[imgpos+1]);
-	write_imageui(channel2, pos, img[imgpos+row_size]);
-	write_imageui(channel3, pos, img[imgpos+1+row_size]);
+	for(int i = 0; i < run; i++) {
+		const int2 pos = (int2)(x0 + i, y);
+		write_imageui(channel0, pos, sample(even, 2*i));
+		write_imageui(channel1, pos, sample(even, 2*i+1));
+		write_imageui(channel2, pos, sample(odd, 2*i));
+		write_imageui(channel3, pos, sample(odd, 2*i+1));
+	}
 #endif
 }
@@ -15,6 +15,7 @@
  */
 #ifndef CL_VERSION_1_0
 #include "clstd.h"
+#define MASK_TILE 16
 #endif
 
 typedef struct __attribute__ ((packed)) {
@@ -49,7 +50,18 @@ inline float2 field2image(const CameraModel m, float3 fieldpos) {
 
 const sampler_t sampler = CLK_FILTER_LINEAR | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
 
-kernel void resampling(read_only image2d_t channel0, read_only image2d_t channel1, read_only image2d_t channel2, read_only image2d_t channel3, write_only image2d_t out, const CameraModel model, const float maxRobotHeight, const float fieldScale, const float fieldOffsetX, const float fieldOffsetY) {
+// Processing mask with one entry per MASK_TILE x MASK_TILE tile, set by the host
+inline bool tileActive(global const uchar* mask, const int2 pos, const int width) {
+	return mask[pos.y/MASK_TILE * ((width + MASK_TILE - 1) / MASK_TILE) + pos.x/MASK_TILE];
+}
+
+kernel void resampling(read_only image2d_t channel0, read_only image2d_t channel1, read_only image2d_t channel2, read_only image2d_t channel3, write_only image2d_t out, global const uchar* mask, const CameraModel model, const float maxRobotHeight, const float fieldScale, const float fieldOffsetX, const float fieldOffsetY) {
+	if(!tileActive(mask, (int2)(get_global_id(0), get_global_id(1)), get_image_width(out))) {
+		// Neutral dRGB
+		write_imageui(out, (int2)(get_global_id(0), get_global_id(1)), (uint4)(127, 127, 127, 255));
+		return;
+	}
+
 	float2 pos = field2image(model, (float3)(get_global_id(0)*fieldScale + fieldOffsetX, get_global_id(1)*fieldScale + fieldOffsetY, maxRobotHeight));
 
 #ifdef BGR
@@ -17,16 +17,19 @@
 #include "clstd.h"
 #endif
 
-const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE;
+const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
 
-void kernel rgb2nv12(read_only image2d_t in, global uchar* out) {
+// Iterates over the output pixels, the input is fit into the output by scale and offset (see Resources::streamMapping)
+void kernel rgb2nv12(read_only image2d_t in, global uchar* out, const float scale, const float offsetX, const float offsetY) {
 	int2 pos = (int2)(get_global_id(0), get_global_id(1));
-	const uint4 v = read_imageui(in, sampler, pos);
+	const float2 src = ((float2)(pos.x, pos.y) + 0.5f) * scale + (float2)(offsetX, offsetY);
+	const bool inside = src.x >= 0.0f && src.y >= 0.0f && src.x < get_image_width(in) && src.y < get_image_height(in);
+	const uint4 v = inside ? read_imageui(in, sampler, src) : (uint4)(0, 0, 0, 255);
 
 	out[pos.x + pos.y*get_global_size(0)] = convert_uchar_sat((66*v.r + 129*v.g + 25*v.b) / 256 + 16);
 
 	pos /= 2;
-	const int uvout = get_image_width(in)*get_image_height(in) + pos.x*2 + pos.y*get_global_size(0);
+	const int uvout = get_global_size(0)*get_global_size(1) + pos.x*2 + pos.y*get_global_size(0);
 	out[uvout] = convert_uchar_sat((-38*(int)v.r + -74*(int)v.g + 112*(int)v.b) / 256 + 128);
     out[uvout+1] = convert_uchar_sat((112*(int)v.r + -94*(int)v.g + -18*(int)v.b) / 256 + 128);
 }
\ No newline at end of file
@@ -15,10 +15,17 @@
  */
 #ifndef CL_VERSION_1_0
 #include "clstd.h"
+#define BLOB_RADIUS 1
+#define MASK_TILE 16
 #endif
 
 const sampler_t sampler = CLK_FILTER_NEAREST | CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE;
 
+// Processing mask with one entry per MASK_TILE x MASK_TILE tile, set by the host
+inline bool tileActive(global const uchar* mask, const int2 pos, const int width) {
+	return mask[pos.y/MASK_TILE * ((width + MASK_TILE - 1) / MASK_TILE) + pos.x/MASK_TILE];
+}
+
 inline float read(read_only image2d_t sat, int2 pos, const int dx, const int dy) {
 	pos.x += dx;
 	pos.y += dy;
@@ -31,8 +38,15 @@ inline float read(read_only image2d_t sat, int2 pos, const int dx, const int dy)
 //https://dl.acm.org/doi/abs/10.5555/2346696.2346743
 //https://blog.demofox.org/2018/04/16/prefix-sums-and-summed-area-tables/
 //https://github.com/Algomorph/clsat https://github.com/Algomorph/clsat/blob/master/src/sat.cl
-kernel void circle(read_only image2d_t sat, write_only image2d_t out, int maxBlobRadius) {
+//BLOB_RADIUS is derived from the geometry by the host
+kernel void circle(read_only image2d_t sat, write_only image2d_t out, global const uchar* mask) {
 	int2 pos = (int2)(get_global_id(0), get_global_id(1));
+	if(!tileActive(mask, pos, get_image_width(out))) {
+		write_imagef(out, pos, 0.0f);
+		return;
+	}
+
+	const int maxBlobRadius = BLOB_RADIUS;
 
 	float ppScore = read(sat, pos,  maxBlobRadius,  maxBlobRadius) - read(sat, pos,  maxBlobRadius,  1) - read(sat, pos,  1,  maxBlobRadius) + read(sat, pos,  1,  1);
 	float pnScore = read(sat, pos,  maxBlobRadius, -maxBlobRadius) - read(sat, pos,  maxBlobRadius, -1) - read(sat, pos,  1, -maxBlobRadius) + read(sat, pos,  1, -1); //inverted
@@ -13,11 +13,13 @@
 #    limitations under the License.
 
 import argparse
+import mmap
 import os
 import pathlib
 import socket
 import struct
 import threading
+import time
 
 from google.protobuf.json_format import MessageToDict
 
@@ -125,3 +127,107 @@ class VisionRecorder(VisionSocket):
 
     def consume(self, wrapper: SSL_WrapperPacket):
         self.packets.append(wrapper)
+
+
+class SharedMemoryVision:
+    """Reads the detection rings of co-located vision processors (network.shm_name), layout see src/shmring.h"""
+
+    MAGIC = 0x52535056
+    VERSION = 1
+    HEADER = struct.Struct('<IIIIQI')
+    SLOT = struct.Struct('<QI')
+
+    def __init__(self, name='vision', cam_ids=(0,), poll_interval=0.0001):
+        self.paths = [f'/dev/shm/{name}_{cam_id}' for cam_id in cam_ids]
+        self.poll_interval = poll_interval
+        self.running = False
+        self.lost = 0
+
+    def consume(self, wrapper: SSL_WrapperPacket):
+        pass
+
+    def _open(self, path, restarted=False):
+        try:
+            with open(path, 'rb') as file:
+                memory = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+        except (FileNotFoundError, ValueError):
+            return None
+
+        magic, version, slot_count, slot_size, head, _ = self.HEADER.unpack_from(memory, 0)
+        if magic != self.MAGIC or version != self.VERSION:
+            memory.close()
+            return None
+
+        # A new reader starts with the next message, after a producer restart all messages of the new producer are read
+        stride = (16 + slot_size + 63) & ~63
+        start = max(head - slot_count, 0) if restarted else head
+        return {'memory': memory, 'slot_count': slot_count, 'slot_size': slot_size, 'stride': stride, 'next': start}
+
+    def _stale(self, ring):
+        """The producer has shut down or replaced the ring, possibly with a different slot count or size"""
+        magic, _, slot_count, slot_size = struct.unpack_from('<IIII', ring['memory'], 0)
+        return magic != self.MAGIC or slot_count != ring['slot_count'] or slot_size != ring['slot_size']
+
+    def _read(self, ring):
+        memory = ring['memory']
+        while True:
+            magic = struct.unpack_from('<I', memory, 0)[0]
+            head = struct.unpack_from('<Q', memory, 16)[0]
+            if magic != self.MAGIC:
+                return None
+            if head < ring['next']:  # Producer restarted
+                ring['next'] = head
+            if head == ring['next']:
+                return None
+            if head - ring['next'] > ring['slot_count']:
+                self.lost += head - ring['next'] - ring['slot_count']
+                ring['next'] = head - ring['slot_count']
+
+            n = ring['next']
+            offset = 64 + (n % ring['slot_count']) * ring['stride']
+            expected = 2*n + 2
+            ring['next'] += 1
+            sequence, length = self.SLOT.unpack_from(memory, offset)
+            if sequence == expected:
+                data = memory[offset + 16:offset + 16 + min(length, ring['slot_size'])]
+                if struct.unpack_from('<Q', memory, offset)[0] == expected:
+                    return data
+
+            # Overwritten while reading
+            self.lost += 1
+
+    def _receive_thread(self):
+        rings = {}
+        while self.running:
+            received = False
+            for path in self.paths:
+                if path not in rings or self._stale(rings[path]):
+                    ring = self._open(path, restarted=path in rings)
+                    if ring is None:
+                        continue
+                    if path in rings:
+                        rings[path]['memory'].close()
+                    rings[path] = ring
+
+                data = self._read(rings[path])
+                if data is not None:
+                    wrapper = SSL_WrapperPacket()
+                    wrapper.ParseFromString(data)
+                    self.consume(wrapper)
+                    received = True
+
+            if not received:
+                time.sleep(self.poll_interval)
+
+        for ring in rings.values():
+            ring['memory'].close()
+
+    def __enter__(self):
+        self.running = True
+        self.thread = threading.Thread(target=self._receive_thread, name="Shared memory vision receiver")
+        self.thread.start()
+        return self
+
+    def __exit__(self, exc_type, exc_val, exc_tb):
+        self.running = False
+        self.thread.join()
@@ -171,6 +171,15 @@ Eigen::Vector3f CameraModel::image2field(const Eigen::Vector2f& p, const float h
 	return camRay;
 }
 
+Eigen::Vector3f CameraModel::reprojectHeight(const Eigen::Vector3f& p, const float height) const {
+	if(p.z() >= pos.z())
+		return { NAN, NAN, NAN };
+
+	Eigen::Vector3f ray = (p - pos) * ((height - pos.z()) / (p.z() - pos.z())) + pos;
+	ray.z() = height;
+	return ray;
+}
+
 void CameraModel::updateEuler(const Eigen::Vector3f &euler) {
 	f2iOrientation = Eigen::AngleAxisf(euler.x(), Eigen::Vector3f::UnitX()) * Eigen::AngleAxisf(euler.y(), Eigen::Vector3f::UnitY()) * Eigen::AngleAxisf(euler.z(), Eigen::Vector3f::UnitZ());
 	updateDerived();
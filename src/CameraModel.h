@@ -39,6 +39,8 @@ public:
 
 	[[nodiscard]] Eigen::Vector2f field2image(const Eigen::Vector3f& p) const;
 	[[nodiscard]] Eigen::Vector3f image2field(const Eigen::Vector2f& p, float height) const;
+	/** Same as image2field(field2image(p), height) without the distortion model, the camera ray of p is a straight line. */
+	[[nodiscard]] Eigen::Vector3f reprojectHeight(const Eigen::Vector3f& p, float height) const;
 
 	void updateEuler(const Eigen::Vector3f& euler);
 	Eigen::Vector3f getEuler();
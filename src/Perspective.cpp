@@ -43,13 +43,13 @@ void Perspective::geometryCheck(const int width, const int height, const double
 			calibFound = true;
 			model = CameraModel(calib);
 			if(!calib.has_derived_camera_world_tx() || !calib.has_derived_camera_world_ty() || !calib.has_derived_camera_world_tz()) {
-				socket->send(model.getProto(camId));
+				const SSL_GeometryCameraCalibration calibration = model.getProto(camId);
 				SSL_WrapperPacket wrapper;
 				wrapper.set_source(SSL_SOURCE_VISION_PROCESSOR);
 				wrapper.mutable_geometry()->CopyFrom(socket->getGeometry());
 				wrapper.mutable_geometry()->clear_calib();
-				wrapper.mutable_geometry()->add_calib()->CopyFrom(model.getProto(camId));
-				socket->send(wrapper);
+				wrapper.mutable_geometry()->add_calib()->CopyFrom(calibration);
+				socket->send({&calibration, &wrapper});
 			}
 			break;
 		}
@@ -122,6 +122,103 @@ void Perspective::geometryCheck(const int width, const int height, const double
 		reprojectedFieldSize[1]++;
 
 	LOG("Visible field extent: " << visibleFieldExtent.transpose() << "mm (xmin,xmax,ymin,ymax) Field scale: " << fieldScale << "mm/px");
+
+	updateProcessingMask(maxBotHeight);
+}
+
+//https://wrfranklin.org/Research/Short_Notes/pnpoly.html
+static bool insidePolygon(const std::vector<Eigen::Vector2f>& polygon, const Eigen::Vector2f& p) {
+	bool inside = false;
+	for(size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++) {
+		const Eigen::Vector2f& a = polygon[i];
+		const Eigen::Vector2f& b = polygon[j];
+		if((a.y() > p.y()) != (b.y() > p.y()) && p.x() < (b.x() - a.x()) * (p.y() - a.y()) / (b.y() - a.y()) + a.x())
+			inside = !inside;
+	}
+	return inside;
+}
+
+static bool insideSensor(const CameraModel& model, const Eigen::Vector3f& fieldPos) {
+	if((model.f2iTransformation * fieldPos).z() <= 0.0f)
+		return false;
+
+	Eigen::Vector2f pos = model.field2image(fieldPos);
+	return pos.x() >= 0.0f && pos.y() >= 0.0f && pos.x() < (float)model.size.x() && pos.y() < (float)model.size.y();
+}
+
+bool Perspective::isProcessed(const Eigen::Vector2f& fieldPos, const double maxBotHeight, const std::vector<CameraModel>& neighbours) const {
+	const float halfLength = (float)field.field_length()/2.0f + goalBoundaryWidth(field) + geometryTolerance;
+	const float halfWidth = (float)field.field_width()/2.0f + (float)field.boundary_width() + geometryTolerance;
+	if(abs(fieldPos.x()) > halfLength || abs(fieldPos.y()) > halfWidth)
+		return false;
+
+	const Eigen::Vector3f pos(fieldPos.x(), fieldPos.y(), (float)maxBotHeight);
+	if(!insideSensor(model, pos))
+		return false;
+
+	for(const std::vector<Eigen::Vector2f>& polygon : exclusionPolygons) {
+		if(insidePolygon(polygon, fieldPos))
+			return false;
+	}
+
+	const float distance = (model.pos.head<2>() - fieldPos).norm();
+	for(const CameraModel& neighbour : neighbours) {
+		if((neighbour.pos.head<2>() - fieldPos).norm() + neighbourOverlap < distance && insideSensor(neighbour, pos))
+			return false;
+	}
+
+	return true;
+}
+
+void Perspective::updateProcessingMask(const double maxBotHeight) {
+	std::vector<CameraModel> neighbours;
+	if(neighbourExclusion) {
+		for(const SSL_GeometryCameraCalibration& calib : socket->getGeometry().calib()) {
+			if(calib.camera_id() != camId)
+				neighbours.emplace_back(calib);
+		}
+	}
+
+	// Kernels read up to the gradient offset plus the blob radius around each pixel, processed tiles include that margin
+	const int margin = (int)ceilf(2.0f * maxBlobRadius / fieldScale) + 1;
+	const int step = std::max(1, (int)(minBlobRadius / fieldScale));
+
+	maskSize = (reprojectedFieldSize.array() + MASK_TILE - 1) / MASK_TILE;
+	std::vector<uint8_t> visible(maskSize.x() * maskSize.y(), 0);
+	for(int tileY = 0; tileY < maskSize.y(); tileY++) {
+		for(int tileX = 0; tileX < maskSize.x(); tileX++) {
+			const int x0 = tileX*MASK_TILE;
+			const int y0 = tileY*MASK_TILE;
+			const int x1 = std::min(x0 + MASK_TILE, reprojectedFieldSize.x()) - 1;
+			const int y1 = std::min(y0 + MASK_TILE, reprojectedFieldSize.y()) - 1;
+
+			bool found = false;
+			for(int y = y0; y <= y1 + step - 1 && !found; y += step) {
+				for(int x = x0; x <= x1 + step - 1 && !found; x += step)
+					found = isProcessed(flat2field({(float)std::min(x, x1), (float)std::min(y, y1)}), maxBotHeight, neighbours);
+			}
+			visible[tileX + tileY*maskSize.x()] = found;
+		}
+	}
+
+	const int tileMargin = (margin + MASK_TILE - 1) / MASK_TILE;
+	processingMask.assign(visible.size(), 0);
+	activeTiles = 0;
+	for(int tileY = 0; tileY < maskSize.y(); tileY++) {
+		for(int tileX = 0; tileX < maskSize.x(); tileX++) {
+			bool active = false;
+			for(int y = std::max(0, tileY - tileMargin); y <= std::min(maskSize.y() - 1, tileY + tileMargin) && !active; y++) {
+				for(int x = std::max(0, tileX - tileMargin); x <= std::min(maskSize.x() - 1, tileX + tileMargin) && !active; x++)
+					active = visible[x + y*maskSize.x()];
+			}
+
+			processingMask[tileX + tileY*maskSize.x()] = active;
+			activeTiles += active;
+		}
+	}
+
+	maskVersion++;
+	LOG("Processing mask: " << activeTiles << "/" << processingMask.size() << " tiles active, " << exclusionPolygons.size() << " exclusion polygons, " << neighbours.size() << " neighbouring cameras");
 }
 
 Eigen::Vector2f Perspective::flat2field(const Eigen::Vector2f& pos) const {
@@ -29,9 +29,14 @@ typedef struct __attribute__ ((packed)) {
 } CLCameraModel;
 
 
+// Edge length in px of the square flat image tiles of the processing mask
+const int MASK_TILE = 16;
+
+
 class Perspective {
 public:
-	Perspective(std::shared_ptr<VisionSocket> socket, int camId, float geometryTolerance): socket(std::move(socket)), camId(camId), geometryTolerance(geometryTolerance) {}
+	Perspective(std::shared_ptr<VisionSocket> socket, int camId, float geometryTolerance, std::vector<std::vector<Eigen::Vector2f>> exclusionPolygons, bool neighbourExclusion, float neighbourOverlap):
+			socket(std::move(socket)), camId(camId), geometryTolerance(geometryTolerance), exclusionPolygons(std::move(exclusionPolygons)), neighbourExclusion(neighbourExclusion), neighbourOverlap(neighbourOverlap) {}
 	void geometryCheck(int width, int height, double maxBotHeight, float resamplingFactor);
 
 	Eigen::Vector2f flat2field(const Eigen::Vector2f& pos) const;
@@ -51,8 +56,23 @@ public:
 
 	int geometryVersion = 0;
 
+	// One entry per MASK_TILE x MASK_TILE tile of the flat image (row-major), 0 if no pixel of the tile or its
+	// neighbourhood sees the field from within the sensor outside of the exclusion polygons
+	std::vector<uint8_t> processingMask;
+	Eigen::Vector2i maskSize = Eigen::Vector2i(0, 0); // [tiles]
+	int activeTiles = 0;
+	int maskVersion = 0; // Increments each time the processing mask has been recalculated
+
 private:
+	void updateProcessingMask(double maxBotHeight);
+	[[nodiscard]] bool isProcessed(const Eigen::Vector2f& fieldPos, double maxBotHeight, const std::vector<CameraModel>& neighbours) const;
+
 	const std::shared_ptr<VisionSocket> socket;
 	const unsigned int camId;
 	const float geometryTolerance;
+	// Field areas in mm to be ignored, e.g. audience areas
+	const std::vector<std::vector<Eigen::Vector2f>> exclusionPolygons;
+	// Ignore field areas closer to the camera position of a neighbouring camera (with an overlap in mm)
+	const bool neighbourExclusion;
+	const float neighbourOverlap;
 };
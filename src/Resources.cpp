@@ -20,6 +20,7 @@
 #include "cl_kernels.h"
 #include "Resources.h"
 #include "driver/cameradriver.h"
+#include "blobs/patternmatcher.h"
 
 template<>
 struct YAML::convert<Eigen::Vector2f> {
@@ -63,6 +64,16 @@ struct YAML::convert<Eigen::Vector3i> {
 	}
 };
 
+// Output pixels per raw2quad work-item (wide loads of a whole run)
+static const int RAW2QUAD_RUN = 8;
+// Work group edge length of the box blob center engine, has to match the processing mask tiles
+static const int BOX_TILE = MASK_TILE;
+// Match slots per blob grid cell and neighbours per center blob of the GPU bot hypotheses, overflows are searched on the host
+static const int BLOB_GRID_CAPACITY = 32;
+static const int BOT_MAX_NEIGHBOURS = 32;
+// Largest blob radius in px for which the automatic engine selection prefers the box engine over the SAT
+static const int BOX_MAX_AUTO_RADIUS = 12;
+
 static YAML::Node getOptional(const YAML::Node& node) {
 	return node.IsDefined() ? node : YAML::Node();
 }
@@ -110,20 +121,61 @@ Resources::Resources(const std::string& configPath) : configPath(configPath) {
 
 	YAML::Node network = getOptional(config["network"]);
 	gcSocket = std::make_shared<GCSocket>(network["gc_ip"].as<std::string>("224.5.23.1"), network["gc_port"].as<int>(10003), YAML::LoadFile(config["bot_heights_file"].as<std::string>("robot-heights.yml")).as<std::map<std::string, double>>());
-	socket = std::make_shared<VisionSocket>(network["vision_ip"].as<std::string>("224.5.23.2"), network["vision_port"].as<int>(10006), camId, gcSocket->defaultBotHeight);
-	perspective = std::make_shared<Perspective>(socket, camId, geometryTolerance);
+	socket = std::make_shared<VisionSocket>(network["vision_ip"].as<std::string>("224.5.23.2"), network["vision_port"].as<int>(10006), camId, gcSocket->defaultBotHeight, (float)maxBotAcceleration, (float)maxBotAngularAcceleration);
+	const std::string shmName = network["shm_name"].as<std::string>("");
+	if(!shmName.empty())
+		shmRing = std::make_shared<ShmRing>("/" + shmName + "_" + std::to_string(camId), (uint32_t)network["shm_slots"].as<int>(64), 65536);
+	YAML::Node processing = getOptional(config["processing"]);
+	perspective = std::make_shared<Perspective>(
+			socket, camId, geometryTolerance,
+			processing["exclusion_polygons"].as<std::vector<std::vector<Eigen::Vector2f>>>(std::vector<std::vector<Eigen::Vector2f>>()),
+			processing["neighbour_exclusion"].as<bool>(false),
+			processing["neighbour_overlap"].as<float>(500.0f)
+	);
 
 	YAML::Node stream = getOptional(config["stream"]);
-	rtpStreamer = std::make_shared<RTPStreamer>(stream["active"].as<bool>(true), "rtp://" + stream["ip_base_prefix"].as<std::string>("224.5.23.") + std::to_string(stream["ip_base_end"].as<int>(100) + camId) + ":" + std::to_string(stream["port"].as<int>(10100)));
+	rtpStreamer = std::make_shared<RTPStreamer>(
+			stream["active"].as<bool>(true),
+			"rtp://" + stream["ip_base_prefix"].as<std::string>("224.5.23.") + std::to_string(stream["ip_base_end"].as<int>(100) + camId) + ":" + std::to_string(stream["port"].as<int>(10100)),
+			stream["fps"].as<int>(30),
+			stream["bitrate"].as<int>(3500000),
+			stream["codecs"].as<std::vector<std::string>>(std::vector<std::string>{"h264_nvenc", "h264_qsv", "h264_vaapi", "libx264"}),
+			stream["encoder_threads"].as<int>(1)
+	);
+	// NV12 chroma is subsampled 2x2
+	streamWidth = stream["width"].as<int>(0) & ~1;
+	streamHeight = stream["height"].as<int>(0) & ~1;
 	rawFeed = stream["raw_feed"].as<bool>(false);
 	snapshotWriter = std::make_shared<SnapshotWriter>();
 
-	raw2quadKernel = openCl->compile(kernel_raw2quad_cl, camera->format().kernelOptions);
-	resampling = openCl->compile(kernel_resampling_cl, camera->format().kernelOptions);
-	gradientDot = openCl->compile(kernel_gradientDot_cl);
+	int threads = processing["threads"].as<int>(0);
+	if(threads < 0) {
+		FATAL("Invalid thread amount, must be >= 0: " << threads);
+	}
+	threadPool = std::make_shared<ThreadPool>(threads == 0 ? (int)std::max(1u, std::thread::hardware_concurrency()) : threads);
+
+	std::string engine = processing["blob_center_engine"].as<std::string>("AUTO");
+	if(engine == "AUTO") {
+		blobCenterEngine = BlobCenterEngine_Auto;
+	} else if(engine == "SAT") {
+		blobCenterEngine = BlobCenterEngine_SAT;
+	} else if(engine == "BOX") {
+		blobCenterEngine = BlobCenterEngine_Box;
+	} else {
+		FATAL("Unknown blob center engine, must be AUTO, SAT or BOX: " << engine);
+	}
+
+	gpuHypotheses = processing["gpu_hypotheses"].as<bool>(false);
+	if(gpuHypotheses) {
+		const std::string options = "-DGRID_CAPACITY=" + std::to_string(BLOB_GRID_CAPACITY) + " -DMAX_NEIGHBOURS=" + std::to_string(BOT_MAX_NEIGHBOURS);
+		blobGrid = openCl->compile(kernel_blobGrid_cl, options);
+		botHypotheses = openCl->compile(kernel_botHypotheses_cl, options);
+	}
+
+	raw2quadKernel = openCl->compile(kernel_raw2quad_cl, std::string(camera->format().kernelOptions) + " -DRUN=" + std::to_string(RAW2QUAD_RUN));
+	resampling = openCl->compile(kernel_resampling_cl, std::string(camera->format().kernelOptions) + " -DMASK_TILE=" + std::to_string(MASK_TILE));
 	satHorizontal = openCl->compile(kernel_satHorizontal_cl);
 	satVertical = openCl->compile(kernel_satVertical_cl);
-	satBlobCenter = openCl->compile(kernel_satBlobCenter_cl);
 	quad2rgbaKernel = openCl->compile(kernel_quad2rgba_cl, camera->format().kernelOptions);
 	quad2nv12 = openCl->compile(kernel_quad2nv12_cl, camera->format().kernelOptions);
 	rgba2nv12 = openCl->compile(kernel_rgba2nv12_cl);
@@ -136,10 +188,24 @@ Resources::Resources(const std::string& configPath) : configPath(configPath) {
 }
 
 void Resources::raw2quad(const RawImage& img, std::shared_ptr<CLImage>* channels) {
+	if(streamWidth <= 0 || streamHeight <= 0) {
+		// Unconfigured stream dimensions follow the quad resolution and aspect ratio
+		if(streamWidth <= 0 && streamHeight <= 0) {
+			streamWidth = img.width;
+			streamHeight = img.height;
+		} else if(streamWidth <= 0) {
+			streamWidth = streamHeight * img.width / img.height;
+		} else {
+			streamHeight = streamWidth * img.height / img.width;
+		}
+		streamWidth &= ~1;
+		streamHeight &= ~1;
+	}
+
 	for(int i = 0; i < 4; i++)
 		channels[i] = openCl->acquire(&PixelFormat::U8, img.width, img.height, img.name);
 
-	openCl->await(raw2quadKernel, cl::EnqueueArgs(cl::NDRange(img.width, img.height)), img.buffer, channels[0]->image, channels[1]->image, channels[2]->image, channels[3]->image);
+	openCl->await(raw2quadKernel, cl::EnqueueArgs(cl::NDRange((img.width + RAW2QUAD_RUN - 1) / RAW2QUAD_RUN, img.height)), img.buffer, channels[0]->image, channels[1]->image, channels[2]->image, channels[3]->image);
 }
 
 std::shared_ptr<CLImage> Resources::quad2rgba(std::shared_ptr<CLImage>* channels) {
@@ -148,28 +214,123 @@ std::shared_ptr<CLImage> Resources::quad2rgba(std::shared_ptr<CLImage>* channels
 	return rgba;
 }
 
+void Resources::updateGeometryKernels() {
+	if(perspective->maskVersion != kernelMaskVersion) {
+		processingMask = std::make_shared<CLArray>(perspective->processingMask.data(), (int)perspective->processingMask.size());
+		kernelMaskVersion = perspective->maskVersion;
+	}
+
+	const int gradientOffset = (int)ceilf(perspective->maxBlobRadius / perspective->fieldScale) / 3;
+	const int blobRadius = (int)ceilf(perspective->minBlobRadius / perspective->fieldScale);
+	const int discRadius = (int)floorf(perspective->minBlobRadius / perspective->fieldScale);
+	if(gradientOffset == kernelGradientOffset && blobRadius == kernelBlobRadius && discRadius == kernelDiscRadius)
+		return;
+
+	std::vector<cl_int> disc;
+	for(int y = -discRadius; y <= discRadius; y++) {
+		for(int x = -discRadius; x <= discRadius; x++) {
+			if(x*x + y*y <= discRadius*discRadius) {
+				disc.push_back(x);
+				disc.push_back(y);
+			}
+		}
+	}
+	blobDisc = std::make_shared<CLArray>(disc.data(), (int)(disc.size() * sizeof(cl_int)));
+
+	const std::string maskOption = " -DMASK_TILE=" + std::to_string(MASK_TILE);
+	double startTime = getRealTime();
+	gradientDot = openCl->compile(kernel_gradientDot_cl, "-DGRADIENT_OFFSET=" + std::to_string(gradientOffset) + maskOption);
+	satBlobCenter = openCl->compile(kernel_satBlobCenter_cl, "-DBLOB_RADIUS=" + std::to_string(blobRadius) + maskOption);
+	boxBlobCenter = openCl->compile(kernel_boxBlobCenter_cl, "-DBLOB_RADIUS=" + std::to_string(blobRadius) + " -DTILE=" + std::to_string(BOX_TILE));
+	blobList = openCl->compile(kernel_blobList_cl, "-DDISC_SIZE=" + std::to_string(disc.size() / 2) + maskOption);
+	LOG("Specialized kernels for gradient offset " << gradientOffset << "px blob radius " << blobRadius << "px disc radius " << discRadius << "px in " << (getRealTime() - startTime) * 1000.0 << " ms");
+
+	kernelGradientOffset = gradientOffset;
+	kernelBlobRadius = blobRadius;
+	kernelDiscRadius = discRadius;
+}
+
 void Resources::rgba2blobCenter(const std::shared_ptr<CLImage>* channels, std::shared_ptr<CLImage>& flat, std::shared_ptr<CLImage>& gradDot, std::shared_ptr<CLImage>& blobCenter) {
+	updateGeometryKernels();
+
 	cl::NDRange visibleFieldRange(perspective->reprojectedFieldSize[0], perspective->reprojectedFieldSize[1]);
 	flat = openCl->acquire(&PixelFormat::RGBA8, perspective->reprojectedFieldSize[0], perspective->reprojectedFieldSize[1], channels[0]->name);
 	gradDot = openCl->acquire(&PixelFormat::F32, perspective->reprojectedFieldSize[0], perspective->reprojectedFieldSize[1], channels[0]->name);
-	std::shared_ptr<CLImage> gradDotHor = openCl->acquire(&PixelFormat::F32, perspective->reprojectedFieldSize[0], perspective->reprojectedFieldSize[1], channels[0]->name);
-	std::shared_ptr<CLImage> gradDotSat = openCl->acquire(&PixelFormat::F32, perspective->reprojectedFieldSize[0], perspective->reprojectedFieldSize[1], channels[0]->name);
 	blobCenter = openCl->acquire(&PixelFormat::F32, perspective->reprojectedFieldSize[0], perspective->reprojectedFieldSize[1], channels[0]->name);
 
-	cl::Event e1 = openCl->run(resampling, cl::EnqueueArgs(visibleFieldRange), channels[0]->image, channels[1]->image, channels[2]->image, channels[3]->image, flat->image, perspective->getCLCameraModel(), (float)gcSocket->maxBotHeight, perspective->fieldScale, perspective->visibleFieldExtent[0], perspective->visibleFieldExtent[2]);
-	cl::Event e2 = openCl->run(gradientDot, cl::EnqueueArgs(e1, visibleFieldRange), flat->image, gradDot->image, (int)ceilf(perspective->maxBlobRadius / perspective->fieldScale) / 3);
-	cl::Event e3 = openCl->run(satHorizontal, cl::EnqueueArgs(e2, cl::NDRange(perspective->reprojectedFieldSize[1])), gradDot->image, gradDotHor->image);
-	cl::Event e4 = openCl->run(satVertical, cl::EnqueueArgs(e3, cl::NDRange(perspective->reprojectedFieldSize[0])), gradDotHor->image, gradDotSat->image);
-	openCl->await(satBlobCenter, cl::EnqueueArgs(e4, visibleFieldRange), gradDotSat->image, blobCenter->image, (int)ceilf(perspective->minBlobRadius / perspective->fieldScale));
+	cl::Event e1 = openCl->run(resampling, cl::EnqueueArgs(visibleFieldRange), channels[0]->image, channels[1]->image, channels[2]->image, channels[3]->image, flat->image, processingMask->buffer, perspective->getCLCameraModel(), (float)gcSocket->maxBotHeight, perspective->fieldScale, perspective->visibleFieldExtent[0], perspective->visibleFieldExtent[2]);
+	cl::Event e2 = openCl->run(gradientDot, cl::EnqueueArgs(e1, visibleFieldRange), flat->image, gradDot->image, processingMask->buffer);
+	gradDot2blobCenter(activeBlobCenterEngine(), e2, *gradDot, *blobCenter);
+}
+
+void Resources::gradDot2blobCenter(BlobCenterEngine engine, const cl::Event& gradDotEvent, const CLImage& gradDot, CLImage& blobCenter) {
+	updateGeometryKernels();
+
+	if(engine == BlobCenterEngine_Box) {
+		cl::NDRange tiledRange((gradDot.width + BOX_TILE - 1) / BOX_TILE * BOX_TILE, (gradDot.height + BOX_TILE - 1) / BOX_TILE * BOX_TILE);
+		openCl->await(boxBlobCenter, cl::EnqueueArgs(gradDotEvent, tiledRange, cl::NDRange(BOX_TILE, BOX_TILE)), gradDot.image, blobCenter.image, processingMask->buffer);
+		return;
+	}
+
+	std::shared_ptr<CLImage> gradDotHor = openCl->acquire(&PixelFormat::F32, gradDot.width, gradDot.height, gradDot.name);
+	std::shared_ptr<CLImage> gradDotSat = openCl->acquire(&PixelFormat::F32, gradDot.width, gradDot.height, gradDot.name);
+	cl::Event e1 = openCl->run(satHorizontal, cl::EnqueueArgs(gradDotEvent, cl::NDRange(gradDot.height)), gradDot.image, gradDotHor->image);
+	cl::Event e2 = openCl->run(satVertical, cl::EnqueueArgs(e1, cl::NDRange(gradDot.width)), gradDotHor->image, gradDotSat->image);
+	openCl->await(satBlobCenter, cl::EnqueueArgs(e2, cl::NDRange(gradDot.width, gradDot.height)), gradDotSat->image, blobCenter.image, processingMask->buffer);
+}
+
+BlobCenterEngine Resources::activeBlobCenterEngine() const {
+	if(blobCenterEngine != BlobCenterEngine_Auto)
+		return blobCenterEngine;
+
+	return kernelBlobRadius <= BOX_MAX_AUTO_RADIUS ? BlobCenterEngine_Box : BlobCenterEngine_SAT;
+}
+
+void Resources::matches2botHypotheses(const CLArray& matchArray, const CLArray& counter, CLArray& botMatchArray) {
+	const float maxRobotRadius = perspective->field.max_robot_radius();
+	const float cellSize = maxRobotRadius / perspective->fieldScale; // [px]
+	const Eigen::Vector2i gridSize = (perspective->reprojectedFieldSize.cast<float>() / cellSize).array().ceil().cast<int>().max(1);
+	if(gridSize != blobGridSize) {
+		blobGridCounts = std::make_shared<CLArray>(gridSize.x() * gridSize.y() * (int)sizeof(cl_int));
+		blobGridCells = std::make_shared<CLArray>(gridSize.x() * gridSize.y() * BLOB_GRID_CAPACITY * (int)sizeof(cl_int));
+		blobGridSize = gridSize;
+	}
+
+	{
+		CLMap<int> counts = blobGridCounts->write<int>();
+		std::fill(*counts, *counts + gridSize.x() * gridSize.y(), 0);
+	}
+
+	float tolerance;
+	float gapTolerance;
+	PatternMatcher::tolerances(minConfidence, tolerance, gapTolerance);
+
+	cl::Event e1 = openCl->run(blobGrid, cl::EnqueueArgs(cl::NDRange(maxBlobs)), matchArray.buffer, counter.buffer, blobGridCounts->buffer, blobGridCells->buffer, cellSize, gridSize.x(), gridSize.y(), maxBlobs);
+	openCl->await(botHypotheses, cl::EnqueueArgs(e1, cl::NDRange(maxBlobs)), matchArray.buffer, counter.buffer, blobGridCounts->buffer, blobGridCells->buffer, botMatchArray.buffer, cellSize, gridSize.x(), gridSize.y(), perspective->fieldScale, maxRobotRadius, tolerance, gapTolerance, maxBlobs);
+}
+
+float Resources::streamMapping(const int width, const int height, float& offsetX, float& offsetY) const {
+	const float scale = std::max((float)width / (float)streamWidth, (float)height / (float)streamHeight);
+	offsetX = ((float)width - scale * (float)streamWidth) / 2.0f;
+	offsetY = ((float)height - scale * (float)streamHeight) / 2.0f;
+	return scale;
 }
 
 void Resources::streamQuad(std::shared_ptr<CLImage>* channels) {
-	std::shared_ptr<RawImage> nv12 = openCl->acquireNV12(channels[0]->width, channels[0]->height);
-	openCl->await(quad2nv12, cl::EnqueueArgs(cl::NDRange(channels[0]->width, channels[0]->height)), channels[0]->image, channels[1]->image, channels[2]->image, channels[3]->image, nv12->buffer);
+	if(!rtpStreamer->frameDue())
+		return;
+
+	float offsetX, offsetY;
+	const float scale = streamMapping(channels[0]->width, channels[0]->height, offsetX, offsetY);
+	std::shared_ptr<RawImage> nv12 = openCl->acquireNV12(streamWidth, streamHeight);
+	openCl->await(quad2nv12, cl::EnqueueArgs(cl::NDRange(streamWidth, streamHeight)), channels[0]->image, channels[1]->image, channels[2]->image, channels[3]->image, nv12->buffer, scale, offsetX, offsetY);
 	rtpStreamer->sendFrame(nv12);
 }
 
 void Resources::streamImage(CLImage &img) {
+	if(!rtpStreamer->frameDue())
+		return;
+
 	cl::Kernel kernel;
 	if(img.format == &PixelFormat::RGBA8) {
 		kernel = rgba2nv12;
@@ -180,8 +341,10 @@ void Resources::streamImage(CLImage &img) {
 		return;
 	}
 
-	std::shared_ptr<RawImage> nv12 = openCl->acquireNV12(img.width, img.height);
-	openCl->await(kernel, cl::EnqueueArgs(cl::NDRange(img.width, img.height)), img.image, nv12->buffer);
+	float offsetX, offsetY;
+	const float scale = streamMapping(img.width, img.height, offsetX, offsetY);
+	std::shared_ptr<RawImage> nv12 = openCl->acquireNV12(streamWidth, streamHeight);
+	openCl->await(kernel, cl::EnqueueArgs(cl::NDRange(streamWidth, streamHeight)), img.image, nv12->buffer, scale, offsetX, offsetY);
 	rtpStreamer->sendFrame(nv12);
 }
 
@@ -197,6 +360,12 @@ void Resources::applyTunables(const YAML::Node& config) {
 	YAML::Node tracking = getOptional(config["tracking"]);
 	minTrackingRadius = tracking["min_tracking_radius"].as<double>(20.0);
 	maxBotAcceleration = 1000 * tracking["max_bot_acceleration"].as<double>(6.5);
+	maxBotAngularAcceleration = tracking["max_bot_angular_acceleration"].as<double>(50.0);
+	if(socket)
+		socket->setMaxBotAcceleration((float)maxBotAcceleration, (float)maxBotAngularAcceleration);
+	maxTrackedEvaluations = tracking["max_evaluations"].as<int>(4096);
+	if(maxTrackedEvaluations < 1)
+		FATAL("Invalid tracked evaluation limit, must be >= 1: " << maxTrackedEvaluations);
 
 	YAML::Node color = getOptional(config["color"]);
 	referenceForce = color["reference_force"].as<float>(0.1f);
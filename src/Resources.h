@@ -21,10 +21,12 @@
 #include <yaml-cpp/node/node.h>
 #include "driver/cameradriver.h"
 #include "rtpstreamer.h"
+#include "shmring.h"
 #include "snapshotwriter.h"
 #include "udpsocket.h"
 #include "Perspective.h"
 #include "opencl.h"
+#include "threadpool.h"
 
 
 typedef struct __attribute__ ((packed)) RGB {
@@ -36,6 +38,15 @@ typedef struct __attribute__ ((packed)) RGB {
 } RGB;
 
 
+enum BlobCenterEngine {
+	BlobCenterEngine_Auto,
+	// Summed-area table with two sequential passes
+	BlobCenterEngine_SAT,
+	// Separable quadrant box sums in local memory
+	BlobCenterEngine_Box
+};
+
+
 class Resources {
 public:
 	explicit Resources(const std::string& configPath);
@@ -47,7 +58,10 @@ public:
 	int camId;
 
 	double minTrackingRadius;
+	// Applied to the VisionSocket Kalman filters on each (re)load, read them through VisionSocket
 	double maxBotAcceleration; // mm/s²
+	double maxBotAngularAcceleration; // rad/s²
+	int maxTrackedEvaluations;
 
 	double minCircularity;
 	double minScore;
@@ -84,16 +98,21 @@ public:
 	double maxLineSegmentAngle;
 
 	std::string groundTruth;
+	BlobCenterEngine blobCenterEngine;
+	bool gpuHypotheses;
+
 	bool debugImages;
 	int debugStreamIntervalMs;
 	bool rawFeed;
 
 	std::shared_ptr<GCSocket> gcSocket;
 	std::shared_ptr<VisionSocket> socket;
+	std::shared_ptr<ShmRing> shmRing; // nullptr if disabled
 	std::shared_ptr<Perspective> perspective;
 	std::shared_ptr<OpenCL> openCl;
 	std::shared_ptr<RTPStreamer> rtpStreamer;
 	std::shared_ptr<SnapshotWriter> snapshotWriter;
+	std::shared_ptr<ThreadPool> threadPool;
 
 	cl::Kernel raw2quadKernel;
 	cl::Kernel resampling;
@@ -101,21 +120,51 @@ public:
 	cl::Kernel satHorizontal;
 	cl::Kernel satVertical;
 	cl::Kernel satBlobCenter;
+	cl::Kernel boxBlobCenter;
 	cl::Kernel quad2rgbaKernel;
 	cl::Kernel quad2nv12;
 	cl::Kernel rgba2nv12;
 	cl::Kernel f2nv12;
+	// Specialized with the blob radii of the current geometry by rgba2blobCenter
+	cl::Kernel blobList;
+	std::shared_ptr<CLArray> blobDisc;
+	cl::Kernel blobGrid;
+	cl::Kernel botHypotheses;
+	// Perspective::processingMask of the current geometry, skipped tiles are not processed by the blob kernels
+	std::shared_ptr<CLArray> processingMask;
 
 	void raw2quad(const RawImage& img, std::shared_ptr<CLImage>* channels);
 	std::shared_ptr<CLImage> quad2rgba(std::shared_ptr<CLImage>* channels);
 	void rgba2blobCenter(const std::shared_ptr<CLImage>* channels, std::shared_ptr<CLImage>& flat, std::shared_ptr<CLImage>& gradDot, std::shared_ptr<CLImage>& blobCenter);
+	// Blob center scoring of gradDot with the given engine after gradDotEvent, blocks until completion
+	void gradDot2blobCenter(BlobCenterEngine engine, const cl::Event& gradDotEvent, const CLImage& gradDot, CLImage& blobCenter);
+	[[nodiscard]] BlobCenterEngine activeBlobCenterEngine() const;
+	// Best untracked bot pattern per blobList match into botMatchArray (one entry per match, see botHypotheses.cl), blocks until completion
+	void matches2botHypotheses(const CLArray& matchArray, const CLArray& counter, CLArray& botMatchArray);
 
 	void streamQuad(std::shared_ptr<CLImage>* channels);
 	void streamImage(CLImage& img);
 
+	// Fixed RTP stream resolution (stream.width/height), all streamed images are scaled to it. Unconfigured dimensions are set from the quad resolution by the first raw2quad.
+	int streamWidth = 0;
+	int streamHeight = 0;
+
 private:
+	// Scale (input pixels per stream pixel) and input offset fitting width x height into the stream resolution, centered with letterbox
+	float streamMapping(int width, int height, float& offsetX, float& offsetY) const;
+
 	std::string configPath;
 	int64_t configMtime = 0;
 	double lastConfigCheckTime = 0.0;
 	void applyTunables(const YAML::Node& config);
+
+	int kernelGradientOffset = -1;
+	int kernelBlobRadius = -1;
+	int kernelDiscRadius = -1;
+	int kernelMaskVersion = -1;
+
+	Eigen::Vector2i blobGridSize = Eigen::Vector2i(0, 0);
+	std::shared_ptr<CLArray> blobGridCounts;
+	std::shared_ptr<CLArray> blobGridCells;
+	void updateGeometryKernels();
 };
@@ -0,0 +1,84 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "blobgrid.h"
+
+#include <cmath>
+
+BlobGrid::BlobGrid(std::vector<Match>& matches, float cellSize) {
+	if(matches.empty())
+		return;
+
+	Eigen::Vector2f max = matches[0].pos;
+	origin = matches[0].pos;
+	for(const Match& match : matches) {
+		origin = origin.cwiseMin(match.pos);
+		max = max.cwiseMax(match.pos);
+	}
+
+	invCellSize = 1.0f / std::max(cellSize, 1.0f);
+	width = (int)((max.x() - origin.x()) * invCellSize) + 1;
+	height = (int)((max.y() - origin.y()) * invCellSize) + 1;
+
+	// Counting sort by cell, stable in match order
+	std::vector<int> cells(matches.size());
+	cellStart.assign(width*height + 1, 0);
+	for(size_t i = 0; i < matches.size(); i++) {
+		const Eigen::Vector2f cell = (matches[i].pos - origin) * invCellSize;
+		cells[i] = std::min((int)cell.x(), width-1) + std::min((int)cell.y(), height-1) * width;
+		cellStart[cells[i] + 1]++;
+	}
+	for(int c = 0; c < width*height; c++)
+		cellStart[c + 1] += cellStart[c];
+
+	std::vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+	positions.resize(matches.size());
+	sorted.resize(matches.size());
+	for(size_t i = 0; i < matches.size(); i++) {
+		const int k = fill[cells[i]]++;
+		positions[k] = matches[i].pos;
+		sorted[k] = &matches[i];
+	}
+}
+
+void BlobGrid::rangeSearch(std::vector<Match*>& values, const Eigen::Vector2f& point, const float radius) const {
+	if(sorted.empty())
+		return;
+
+	const Eigen::Vector2f min = (point - origin).array() * invCellSize - radius * invCellSize;
+	const Eigen::Vector2f max = (point - origin).array() * invCellSize + radius * invCellSize;
+	if(max.x() < 0.0f || max.y() < 0.0f || min.x() >= (float)width || min.y() >= (float)height)
+		return;
+
+	const int x0 = std::max((int)min.x(), 0);
+	const int x1 = std::min((int)max.x(), width-1);
+	const int y0 = std::max((int)min.y(), 0);
+	const int y1 = std::min((int)max.y(), height-1);
+	const float sqRadius = radius*radius;
+
+	// Cells x0..x1 of a row are contiguous
+	for(int y = y0; y <= y1; y++) {
+		const int end = cellStart[x1 + 1 + y*width];
+		for(int k = cellStart[x0 + y*width]; k < end; k++) {
+			if((positions[k] - point).squaredNorm() <= sqRadius)
+				values.push_back(sorted[k]);
+		}
+	}
+}
+
+void BlobGrid::rangeSearch(std::vector<Match*>* values, const Eigen::Vector2f* points, const int n, const float* radii) const {
+	for(int i = 0; i < n; i++)
+		rangeSearch(values[i], points[i], radii[i]);
+}
@@ -0,0 +1,44 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+#include <vector>
+#include "match.h"
+
+/** Static uniform grid over all matches of a frame, built in O(n) into contiguous cell-sorted arrays. */
+class BlobGrid {
+public:
+	BlobGrid() = default;
+	/** cellSize should be about the largest search radius, e.g. max_robot_radius. Matches must outlive the grid. */
+	BlobGrid(std::vector<Match>& matches, float cellSize);
+
+	/** Append all matches within radius of point, ordered by cell and match index. */
+	void rangeSearch(std::vector<Match*>& values, const Eigen::Vector2f& point, float radius) const;
+	/** Batched rangeSearch, appends the results for points[i] within radii[i] to values[i]. */
+	void rangeSearch(std::vector<Match*>* values, const Eigen::Vector2f* points, int n, const float* radii) const;
+
+	[[nodiscard]] inline int getSize() const { return (int)sorted.size(); }
+
+private:
+	Eigen::Vector2f origin = {0.0f, 0.0f};
+	float invCellSize = 1.0f;
+	int width = 0;
+	int height = 0;
+
+	std::vector<int> cellStart; // width*height + 1 offsets into positions/sorted
+	std::vector<Eigen::Vector2f> positions;
+	std::vector<Match*> sorted;
+};
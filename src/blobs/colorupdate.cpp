@@ -39,13 +39,13 @@ static bool ballAtLine(const Resources& r, const BallHypothesis& ball) {
 	return false;
 }
 
-static void determineFieldLineBlobColor(Resources& r, const std::list<std::unique_ptr<BallHypothesis>>& ballHypotheses) {
+static void determineFieldLineBlobColor(Resources& r, const std::vector<BallHypothesis>& ballHypotheses) {
 	Eigen::Vector3i colorSum(0, 0, 0);
 	int amount = 0;
 
 	for (const auto& ball : ballHypotheses) {
-		if(ballAtLine(r, *ball)) {
-			colorSum += ball->blob->color;
+		if(ballAtLine(r, ball)) {
+			colorSum += ball.blob->color;
 			amount++;
 		}
 	}
@@ -60,7 +60,20 @@ static inline void updateColor(const Resources& r, const Eigen::Vector3i& refere
 	color = (r.referenceForce*reference.cast<float>() + r.historyForce*oldColor.cast<float>() + updateForce*color.cast<float>()).cast<int>();
 }
 
-void updateColors(Resources& r, const std::list<std::unique_ptr<BotHypothesis>>& bestBotModels, const std::list<std::unique_ptr<BallHypothesis>>& ballCandidates) {
+void classifyColors(const Resources& r, std::vector<Match>& matches) {
+	for(Match& match : matches) {
+		const Eigen::Vector3i& color = match.color;
+		match.blueMargin = (color - r.yellow).squaredNorm() - (color - r.blue).squaredNorm();
+		match.greenMargin = (color - r.pink).squaredNorm() - (color - r.green).squaredNorm();
+
+		const int falseOrange = (color - r.field).squaredNorm();
+		const int orange = (color - r.orange).squaredNorm();
+		const int fieldLine = (color - r.fieldLineColor).squaredNorm();
+		match.orangeScore = falseOrange <= orange || fieldLine <= orange ? 0.0f : 1 - (float)orange / (float)falseOrange;
+	}
+}
+
+void updateColors(Resources& r, const std::vector<BotHypothesis>& bestBotModels, const std::vector<BallHypothesis>& ballCandidates) {
 	Eigen::Vector3i oldField = r.field;
 	Eigen::Vector3i oldOrange = r.orange;
 	Eigen::Vector3i oldYellow = r.yellow;
@@ -74,12 +87,12 @@ void updateColors(Resources& r, const std::list<std::unique_ptr<BotHypothesis>>&
 	Eigen::Vector3i green(0, 0, 0);
 	int greenN = 0;
 	for (const auto& model : bestBotModels) {
-		if(model->blobs[0] != nullptr)
-			centerBlobs.push_back(model->blobs[0]->color);
+		if(model.blobs[0] != nullptr)
+			centerBlobs.push_back(model.blobs[0]->color);
 
-		int botId = model->botId % 16;
+		int botId = model.botId % 16;
 		for(int i = 1; i < 5; i++) {
-			const Match* blob = model->blobs[i];
+			const Match* blob = model.blobs[i];
 			if(blob == nullptr)
 				continue;
 
@@ -109,7 +122,7 @@ void updateColors(Resources& r, const std::list<std::unique_ptr<BotHypothesis>>&
 
 	std::vector<Eigen::Vector3i> ballBlobs;
 	for (const auto& ball : ballCandidates)
-		ballBlobs.push_back(ball->blob->center);
+		ballBlobs.push_back(ball.blob->center);
 
 	if(kMeans(r.blue, ballBlobs, r.orange, r.field)) {
 		updateColor(r, r.orangeReference, oldOrange, r.orange);
@@ -2,4 +2,7 @@
 #include "Resources.h"
 #include "hypothesis.h"
 
-void updateColors(Resources& r, const std::list<std::unique_ptr<BotHypothesis>>& bestBotModels, const std::list<std::unique_ptr<BallHypothesis>>& ballCandidates);
+/** Classifies every match once against the current learned colors, required again after updateColors */
+void classifyColors(const Resources& r, std::vector<Match>& matches);
+
+void updateColors(Resources& r, const std::vector<BotHypothesis>& bestBotModels, const std::vector<BallHypothesis>& ballCandidates);
@@ -16,60 +16,149 @@
 #include "hypothesis.h"
 #include "kmeans.h"
 #include "pattern.h"
+#include "fastmath.h"
 
 
-//atan2 implementation adapted from: https://mazzo.li/posts/vectorized-atan2.html https://gist.github.com/bitonic/d0f5a0a44e37d4f0be03d34d47acb6cf
-static inline float atan_fma_approximation(float x) {
-	float a1  =  0.99997726f;
-	float a3  = -0.33262347f;
-	float a5  =  0.19354346f;
-	float a7  = -0.11643287f;
-	float a9  =  0.05265332f;
-	float a11 = -0.01172120f;
+// (sin, cos) of the pattern angle of each blob pair, see BotGeometryBatch::evaluate
+struct PairRotations {
+	float sin[5][5];
+	float cos[5][5];
 
-	// Compute approximation using Horner's method
-	float x_sq = x*x;
-	return x * fmaf(x_sq, fmaf(x_sq, fmaf(x_sq, fmaf(x_sq, fmaf(x_sq, a11, a9), a7), a5), a3), a1);
+	PairRotations() {
+		for(int a = 0; a < 5; a++) {
+			for(int b = 0; b < 5; b++) {
+				sin[a][b] = sinf(patternAnglesb2b[b*5 + a]);
+				cos[a][b] = cosf(patternAnglesb2b[b*5 + a]);
+			}
+		}
+	}
+};
+static const PairRotations pairRotations;
+
+static inline float trackingFactor(const float x, const float y, const float orientation, const float blobAmount, const Eigen::Vector3f& trackedPosition) {
+	const float rotationOffset = wrapAngle(orientation - trackedPosition.z()) / (float)M_PI;
+	const float dx = (x - trackedPosition.x()) / 10.0f; // (10.0f) 1cm offset -> 0.5 score
+	const float dy = (y - trackedPosition.y()) / 10.0f;
+	return blobAmount / 5.0f / (1 + dx*dx + dy*dy + rotationOffset*rotationOffset);
+}
+
+
+void BotGeometryBatch::push(const Match* a, const Match* b, const Match* c, const Match* d, const Match* e) {
+	const Match* const candidate[5] = {a, b, c, d, e};
+	for(int i = 0; i < 5; i++) {
+		const Match* blob = candidate[i];
+		blobs[size][i] = blob;
+		x[i][size] = blob != nullptr ? blob->pos.x() : 0.0f;
+		y[i][size] = blob != nullptr ? blob->pos.y() : 0.0f;
+		weight[i][size] = blob != nullptr ? 1.0f : 0.0f;
+	}
+	size++;
 }
 
-float atan2_fast(const float y, const float x) {
-	const float pi = M_PI;
-	const float pi_2 = M_PI_2;
+void BotGeometryBatch::evaluate() {
+	// Unused lanes are calculated as candidates without blobs
+	for(int l = size; l < LANES; l++) {
+		for(int i = 0; i < 5; i++) {
+			x[i][l] = 0.0f;
+			y[i][l] = 0.0f;
+			weight[i][l] = 0.0f;
+		}
+	}
 
-	// Ensure input is in [-1, +1]
-	bool swap = fabsf(x) < fabsf(y);
-	float divisor = (swap ? y : x);
-	if(divisor == 0.0) //TODO look further why this extra check is necessary (why both arguments are 0)
-		return swap ? x : y;
+	for(int l = 0; l < LANES; l++)
+		blobAmount[l] = weight[0][l] + weight[1][l] + weight[2][l] + weight[3][l] + weight[4][l];
 
-	const float atan_input = (swap ? x : y) / divisor;
+	//https://www.themathdoctors.org/averaging-angles/
+	//sin and cos of (blob pair angle - pattern angle) are the blob pair direction rotated by the pattern angle,
+	//which requires neither atan2 nor sincos per pair
+	alignas(64) float oSin[LANES] = {};
+	alignas(64) float oCos[LANES] = {};
+	for(int a = 0; a < 5; a++) {
+		for(int b = a+1; b < 5; b++) {
+			const float pSin = pairRotations.sin[a][b];
+			const float pCos = pairRotations.cos[a][b];
+			for(int l = 0; l < LANES; l++) {
+				const float dx = x[b][l] - x[a][l];
+				const float dy = y[b][l] - y[a][l];
+				const float sqLength = dx*dx + dy*dy;
+				const float scale = sqLength > 0.0f ? weight[a][l] * weight[b][l] / sqrtf(sqLength) : 0.0f;
+				oSin[l] += (dy*pCos - dx*pSin) * scale;
+				oCos[l] += (dx*pCos + dy*pSin) * scale;
+			}
+		}
+	}
 
-	// Approximate atan
-	float res = atan_fma_approximation(atan_input);
+	alignas(64) float rSin[LANES];
+	alignas(64) float rCos[LANES];
+	for(int l = 0; l < LANES; l++) {
+		const float sqLength = oSin[l]*oSin[l] + oCos[l]*oCos[l];
+		const bool oriented = blobAmount[l] > 1.0f && sqLength > 0.0f;
+		const float scale = oriented ? 1.0f / sqrtf(sqLength) : 0.0f;
+		rSin[l] = oriented ? oSin[l] * scale : 0.0f;
+		rCos[l] = oriented ? oCos[l] * scale : 1.0f;
+		orientation[l] = oriented ? atan2_fast(oSin[l], oCos[l]) : 0.0f;
+	}
 
-	// If swapped, adjust atan output
-	res = swap ? copysignf(pi_2, atan_input) - res : res;
-	// Adjust the result depending on the input quadrant
-	if (x < 0.0f) {
-		res = copysignf(pi, y) + res;
+	for(int l = 0; l < LANES; l++) {
+		posX[l] = 0.0f;
+		posY[l] = 0.0f;
+	}
+	for(int i = 0; i < 5; i++) {
+		const float px = patternPos[i].x();
+		const float py = patternPos[i].y();
+		for(int l = 0; l < LANES; l++) {
+			posX[l] += weight[i][l] * (x[i][l] - (rCos[l]*px - rSin[l]*py));
+			posY[l] += weight[i][l] * (y[i][l] - (rSin[l]*px + rCos[l]*py));
+		}
+	}
+	for(int l = 0; l < LANES; l++) {
+		const float scale = 1.0f / std::max(blobAmount[l], 1.0f);
+		posX[l] *= scale;
+		posY[l] *= scale;
+		offsetScore[l] = 1.0f;
 	}
 
-	return res;
+	for(int i = 0; i < 5; i++) {
+		const float px = patternPos[i].x();
+		const float py = patternPos[i].y();
+		for(int l = 0; l < LANES; l++) {
+			const float dx = (x[i][l] - (posX[l] + rCos[l]*px - rSin[l]*py)) / 10.0f; // (10.0f) 1cm offset -> 0.5 score
+			const float dy = (y[i][l] - (posY[l] + rSin[l]*px + rCos[l]*py)) / 10.0f;
+			const float blobScore = weight[i][l] > 0.0f ? 1 / (1 + dx*dx + dy*dy) : 1.0f;
+			offsetScore[l] = std::min(offsetScore[l], blobScore);
+		}
+	}
+}
+
+void BotGeometryBatch::applyTracking(const Eigen::Vector3f& trackedPosition) {
+	for(int l = 0; l < LANES; l++)
+		offsetScore[l] *= trackingFactor(posX[l], posY[l], orientation[l], blobAmount[l], trackedPosition);
+}
+
+void BotGeometryBatch::selectBest(float& bestScore, const Match* best[5]) {
+	for(int l = 0; l < size; l++) {
+		if(offsetScore[l] > bestScore) {
+			bestScore = offsetScore[l];
+			std::copy(blobs[l], blobs[l] + 5, best);
+		}
+	}
+	clear();
 }
 
 
 BallHypothesis::BallHypothesis(const Resources& r, const Match* blob): blob(blob), pos(blob->pos) {
-	calcColorScore(r);
+	calcColorScore();
 }
 
 void BallHypothesis::recalcPostColorCalib(const Resources& r) {
 	score = 1.0f;
-	calcColorScore(r);
+	calcColorScore();
 }
 
-void BallHypothesis::addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection) {
-	const Eigen::Vector2f imgPos = r.perspective->model.field2image({pos.x(), pos.y(), (float)r.gcSocket->maxBotHeight});
-	const Eigen::Vector3f ballPos = r.perspective->model.image2field(imgPos, r.perspective->field.ball_radius());
+void BallHypothesis::addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection) const {
+	const Eigen::Vector3f fieldPos(pos.x(), pos.y(), (float)r.gcSocket->maxBotHeight);
+	const Eigen::Vector2f imgPos = r.perspective->model.field2image(fieldPos);
+	const Eigen::Vector3f ballPos = r.perspective->model.reprojectHeight(fieldPos, r.perspective->field.ball_radius());
 	SSL_DetectionBall* ball = detection->add_balls();
 	ball->set_confidence(score);
 	//ball->set_area(0);
@@ -80,27 +169,21 @@ void BallHypothesis::addToDetectionFrame(const Resources& r, SSL_DetectionFrame*
 	ball->set_pixel_y(imgPos.y());
 }
 
-void BallHypothesis::calcColorScore(const Resources& r) {
-	int falseOrange = (blob->color - r.field).squaredNorm();
-	int orange = (blob->color - r.orange).squaredNorm();
-	int fieldLine = (blob->color - r.fieldLineColor).squaredNorm();
-
-	if (falseOrange <= orange || fieldLine <= orange) {
-		score = 0;
-		return;
-	}
-
-	score *= 1 - (float)orange / (float)falseOrange;
+void BallHypothesis::calcColorScore() {
+	score *= blob->orangeScore;
 }
 
 
 BotHypothesis::BotHypothesis(const Match* a, const Match* b, const Match* c, const Match* d, const Match* e): blobs{a, b, c, d, e} {
-	for(auto& blob : blobs)
-		if(blob != nullptr)
-			blobAmount++;
-
-	calcPos();
-	calcOffsetScore();
+	BotGeometryBatch batch;
+	batch.push(a, b, c, d, e);
+	batch.evaluate();
+
+	blobAmount = (int)batch.blobAmount[0];
+	orientation = batch.orientation[0];
+	pos = {batch.posX[0], batch.posY[0]};
+	offsetScore = batch.offsetScore[0];
+	score = offsetScore;
 }
 
 bool BotHypothesis::isClipping(const Resources& r, const BotHypothesis& other) const {
@@ -110,38 +193,56 @@ bool BotHypothesis::isClipping(const Resources& r, const BotHypothesis& other) c
 		return false;
 
 	float diffAngle = atan2_fast(diff.y(), diff.x());
-	float selfAngle = remainderf(diffAngle - orientation, 2.0f * M_PI);
-	float otherAngle = remainderf(diffAngle - other.orientation, 2.0f * M_PI);
+	float selfAngle = wrapAngle(diffAngle - orientation);
+	float otherAngle = wrapAngle(diffAngle - other.orientation);
+	float selfSin, selfCos, otherSin, otherCos;
+	sincos_fast(selfAngle, selfSin, selfCos);
+	sincos_fast(otherAngle, otherSin, otherCos);
 
 	float minDistance =
-			(abs(selfAngle) < MIN_ROBOT_OPENING_ANGLE ? MIN_ROBOT_FRONT_DISTANCE/cosf(selfAngle) : MIN_ROBOT_RADIUS) +
-			(abs(otherAngle) < MIN_ROBOT_OPENING_ANGLE ? MIN_ROBOT_FRONT_DISTANCE/cosf(otherAngle) : MIN_ROBOT_RADIUS)
+			(abs(selfAngle) < MIN_ROBOT_OPENING_ANGLE ? MIN_ROBOT_FRONT_DISTANCE/selfCos : MIN_ROBOT_RADIUS) +
+			(abs(otherAngle) < MIN_ROBOT_OPENING_ANGLE ? MIN_ROBOT_FRONT_DISTANCE/otherCos : MIN_ROBOT_RADIUS)
 			- r.clippingTolerance;
 
 	return sqDistance < minDistance*minDistance;
 }
 
 bool BotHypothesis::isClipping(const Resources& r, const BallHypothesis& ball) const {
-	const float clippedBallRadius = 0.48837f * r.perspective->field.ball_radius(); // a ball may clip up to 20% of the top-view area into the robot
-	Eigen::Vector2f diff = ball.pos - pos;
+	return isClipping(r, ball.pos);
+}
+
+// a ball may clip up to 20% of the top-view area into the robot
+static inline float clippedBallRadius(const Resources& r) {
+	return 0.48837f * r.perspective->field.ball_radius();
+}
+
+bool BotHypothesis::isClipping(const Resources& r, const Eigen::Vector2f& ballPos) const {
+	Eigen::Vector2f diff = ballPos - pos;
 	float sqDistance = diff.squaredNorm();
-	float minDistance = MIN_ROBOT_RADIUS + clippedBallRadius;
+	float minDistance = ballClippingDistance(r);
 	if(sqDistance >= minDistance*minDistance)
 		return false;
 
-	float angle = remainderf(atan2_fast(diff.y(), diff.x()) - orientation, 2.0f * M_PI);
+	float angle = wrapAngle(atan2_fast(diff.y(), diff.x()) - orientation);
 	if(abs(angle) >= MIN_ROBOT_OPENING_ANGLE)
 		return true;
 
-	minDistance = (MIN_ROBOT_FRONT_DISTANCE + clippedBallRadius) / cosf(angle) - r.clippingTolerance;
+	float angleSin, angleCos;
+	sincos_fast(angle, angleSin, angleCos);
+	minDistance = (MIN_ROBOT_FRONT_DISTANCE + clippedBallRadius(r)) / angleCos - r.clippingTolerance;
 
 	return sqDistance < minDistance*minDistance;
 }
 
-void BotHypothesis::addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection) {
+float BotHypothesis::ballClippingDistance(const Resources& r) {
+	return MIN_ROBOT_RADIUS + clippedBallRadius(r);
+}
+
+void BotHypothesis::addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection) const {
 	bool yellow = botId < 16;
-	const Eigen::Vector2f imgPos = r.perspective->model.field2image({pos.x(), pos.y(), (float)r.gcSocket->maxBotHeight});
-	const Eigen::Vector3f botPos = r.perspective->model.image2field(imgPos, (float)(yellow ? r.gcSocket->yellowBotHeight : r.gcSocket->blueBotHeight));
+	const Eigen::Vector3f fieldPos(pos.x(), pos.y(), (float)r.gcSocket->maxBotHeight);
+	const Eigen::Vector2f imgPos = r.perspective->model.field2image(fieldPos);
+	const Eigen::Vector3f botPos = r.perspective->model.reprojectHeight(fieldPos, (float)(yellow ? r.gcSocket->yellowBotHeight : r.gcSocket->blueBotHeight));
 	SSL_DetectionRobot* bot = yellow ? detection->add_robots_yellow() : detection->add_robots_blue();
 	bot->set_confidence(score);
 	bot->set_robot_id(botId % 16);
@@ -153,72 +254,34 @@ void BotHypothesis::addToDetectionFrame(const Resources& r, SSL_DetectionFrame*
 	bot->set_pixel_y(imgPos.y());
 }
 
-void BotHypothesis::calcPos() {
-	//https://www.themathdoctors.org/averaging-angles/
-	float oSin = 0;
-	float oCos = 0;
-	for(int a = 0; a < 5; a++) {
-		if(blobs[a] == nullptr)
-			continue;
-
-		for(int b = a+1; b < 5; b++) {
-			if(blobs[b] == nullptr)
-				continue;
-
-			Eigen::Vector2f diff = blobs[b]->pos - blobs[a]->pos;
-			float angleDelta = atan2_fast(diff.y(), diff.x()) - patternAnglesb2b[b*5 + a];
-			oSin += sinf(angleDelta);
-			oCos += cosf(angleDelta);
-		}
-	}
-	if(blobAmount < 1)
-		return;
-
-	if(blobAmount > 1)
-		orientation = atan2_fast(oSin, oCos);
-
-	Eigen::Rotation2Df rotation(orientation);
-	pos.x() = 0;
-	pos.y() = 0;
-	for(int i = 0; i < 5; i++) {
-		if(blobs[i] == nullptr)
-			continue;
-
-		pos += blobs[i]->pos - rotation * patternPos[i];
-	}
-
-	pos /= (float)blobAmount;
+BotHypothesis::BotHypothesis(const Resources& r, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e): BotHypothesis(a, b, c, d, e) {
+	calcBotId(r);
 }
 
-void BotHypothesis::calcOffsetScore() {
-	Eigen::Rotation2Df rotation(orientation);
-	for(int i = 0; i < 5; i++) {
-		const Match* const& blob = blobs[i];
-		if(blob == nullptr)
-			continue;
-
-		Eigen::Vector2f offset = (blob->pos - (pos + rotation * patternPos[i])) / 10.0f; // (10.0f) 1cm offset -> 0.5 score
-		offsetScore = std::min(offsetScore, 1 / (1 + offset.squaredNorm()));
-	}
-
-	score = offsetScore;
-}
+BotHypothesis::BotHypothesis(const Resources& r, const TrackingState& trackedObject, const Eigen::Vector3f& trackedPosition, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e): BotHypothesis(a, b, c, d, e) {
+	tracked = true;
+	botId = trackedObject.id;
 
+	offsetScore *= trackingFactor(pos.x(), pos.y(), orientation, (float)blobAmount, trackedPosition);
 
-DetectionBotHypothesis::DetectionBotHypothesis(const Resources& r, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e): BotHypothesis(a, b, c, d, e) {
-	calcBotId(r);
+	recalcPostColorCalib(r);
 }
 
-void DetectionBotHypothesis::recalcPostColorCalib(const Resources& r) {
-	calcBotId(r);
+void BotHypothesis::recalcPostColorCalib(const Resources& r) {
+	if(tracked) {
+		score = offsetScore;
+		calcTrackingScore(r);
+	} else {
+		calcBotId(r);
+	}
 }
 
-void DetectionBotHypothesis::calcBotId(const Resources& r) {
+void BotHypothesis::calcBotId(const Resources& r) {
 	Eigen::Vector3i green = r.green;
 	Eigen::Vector3i pink = r.pink;
-	kMeans(blobs[0]->color, {blobs[1]->color, blobs[2]->color, blobs[3]->color, blobs[4]->color}, green, pink);
+	kMeans<4>(blobs[0]->color, {blobs[1]->color, blobs[2]->color, blobs[3]->color, blobs[4]->color}, green, pink);
 
-	botId = ((blobs[0]->color - r.blue).squaredNorm() < (blobs[0]->color - r.yellow).squaredNorm() ? 16 : 0) + patternLUT[
+	botId = (blobs[0]->blueMargin > 0 ? 16 : 0) + patternLUT[
 			(((blobs[1]->color - green).squaredNorm() < (blobs[1]->color - pink).squaredNorm() ? 1 : 0) << 3) +
 			(((blobs[2]->color - green).squaredNorm() < (blobs[2]->color - pink).squaredNorm()? 1 : 0) << 2) +
 			(((blobs[3]->color - green).squaredNorm() < (blobs[3]->color - pink).squaredNorm() ? 1 : 0) << 1) +
@@ -226,46 +289,23 @@ void DetectionBotHypothesis::calcBotId(const Resources& r) {
 	];
 }
 
-
-TrackedBotHypothesis::TrackedBotHypothesis(const Resources& r, const TrackingState& tracked, const Eigen::Vector3f& trackedPosition, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e): BotHypothesis(a, b, c, d, e), trackedScore(tracked.confidence), trackedPosition(trackedPosition) {
-	botId = tracked.id;
-
-	float rotationOffset = remainderf(orientation - trackedPosition.z(), 2.0f * M_PI) / (float)M_PI;
-	offsetScore *= 1 / (1 + ((pos - trackedPosition.head<2>()) / 10.0f).squaredNorm() + rotationOffset*rotationOffset); // (10.0f) 1cm offset -> 0.5 score
-	offsetScore *= (float)blobAmount / 5.f;
-
-	TrackedBotHypothesis::recalcPostColorCalib(r);
-}
-
-void TrackedBotHypothesis::recalcPostColorCalib(const Resources& r) {
-	score = offsetScore;
-	calcTrackingScore(r);
-}
-
-void TrackedBotHypothesis::calcTrackingScore(const Resources& r) {
+void BotHypothesis::calcTrackingScore(const Resources& r) {
 	if(blobAmount < 2) {
 		score = 0.0f;
 		return;
 	}
 
 	for(int i = 0; i < 5; i++) {
-		const Match* const& blob = blobs[i];
-		if(blob == nullptr)
-			continue;
-
-		Eigen::Vector3i blobColor;
-		Eigen::Vector3i oppositeColor;
-		if(i == 0) {
-			blobColor = botId >= 16 ? r.blue : r.yellow;
-			oppositeColor = botId >= 16 ? r.yellow : r.blue;
-		} else {
-			blobColor = ((patterns[botId % 16] >> (4-i)) & 1) ? r.green : r.pink;
-			oppositeColor = ((patterns[botId % 16] >> (4-i)) & 1) ? r.pink : r.green;
-		}
-
-		if((blob->color - oppositeColor).squaredNorm() - (blob->color - blobColor).squaredNorm() <= 0) {
+		if(blobs[i] != nullptr && !colorMatches(botId, i, blobs[i])) {
 			score = 0.0f;
 			return;
 		}
 	}
 }
+
+bool BotHypothesis::colorMatches(const int botId, const int i, const Match* blob) {
+	if(i == 0)
+		return botId >= 16 ? blob->blueMargin > 0 : blob->blueMargin < 0;
+
+	return ((patterns[botId % 16] >> (4-i)) & 1) ? blob->greenMargin > 0 : blob->greenMargin < 0;
+}
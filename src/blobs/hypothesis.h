@@ -19,37 +19,88 @@
 #include "match.h"
 #include "Resources.h"
 
-float atan2_fast(float y, float x);
+/**
+ * Structure of arrays batch of candidate blob 5-tuples (nullptr for missing blobs). evaluate() calculates orientation,
+ * position and offset score of all LANES candidates in branch free loops over the lanes, which the compiler turns into
+ * one AVX-512 or two AVX2 iterations. BotHypothesis uses the same calculation for its single candidate.
+ */
+class BotGeometryBatch {
+public:
+	static constexpr int LANES = 16;
+
+	void clear() { size = 0; }
+
+	[[nodiscard]] bool full() const { return size == LANES; }
+
+	void push(const Match* a, const Match* b, const Match* c, const Match* d, const Match* e);
+
+	void evaluate();
+
+	/** Multiplies offsetScore with the deviation from trackedPosition and blob amount factors of TrackedBotHypothesis */
+	void applyTracking(const Eigen::Vector3f& trackedPosition);
+
+	/** Replaces best with the first candidate with an offsetScore above bestScore and clears the batch */
+	void selectBest(float& bestScore, const Match* best[5]);
+
+	int size = 0;
+	const Match* blobs[LANES][5];
+	alignas(64) float orientation[LANES];
+	alignas(64) float posX[LANES];
+	alignas(64) float posY[LANES];
+	alignas(64) float offsetScore[LANES];
+	alignas(64) float blobAmount[LANES];
+
+private:
+	alignas(64) float x[5][LANES];
+	alignas(64) float y[5][LANES];
+	alignas(64) float weight[5][LANES];
+};
 
 
 class BallHypothesis {
 public:
 	BallHypothesis(const Resources& r, const Match* blob);
 
-	virtual void recalcPostColorCalib(const Resources& r);
+	void recalcPostColorCalib(const Resources& r);
 
-	void addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection);
+	void addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection) const;
 
 	const Match* blob;
 	Eigen::Vector2f pos = {0, 0};
 	float score = 1.0f;
 
 private:
-	void calcColorScore(const Resources& r);
+	void calcColorScore();
 };
 
 
+/**
+ * Plain bot hypothesis record, stored by value in contiguous per-frame vectors. Detected hypotheses derive the bot id
+ * from the blob colors, tracked hypotheses take it from the tracked object and verify the blob colors against it.
+ */
 class BotHypothesis {
 public:
-	BotHypothesis(const Match* a, const Match* b, const Match* c, const Match* d, const Match* e);
+	/** Untracked detection */
+	BotHypothesis(const Resources& r, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e);
+
+	/** Detection of a tracked object near its predicted trackedPosition */
+	BotHypothesis(const Resources& r, const TrackingState& trackedObject, const Eigen::Vector3f& trackedPosition, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e);
 
 	[[nodiscard]] bool isClipping(const Resources& r, const BotHypothesis& other) const;
 
 	[[nodiscard]] bool isClipping(const Resources& r, const BallHypothesis& ball) const;
 
-	void addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection);
+	[[nodiscard]] bool isClipping(const Resources& r, const Eigen::Vector2f& ballPos) const;
+
+	/** Distance beyond which a ball never clips a bot */
+	static float ballClippingDistance(const Resources& r);
+
+	/** If blob i of a bot with botId is closer to its pattern color than to the opposite color (see classifyColors) */
+	static bool colorMatches(int botId, int i, const Match* blob);
 
-	virtual void recalcPostColorCalib(const Resources& r) = 0;
+	void addToDetectionFrame(const Resources& r, SSL_DetectionFrame* detection) const;
+
+	void recalcPostColorCalib(const Resources& r);
 
 	const Match* blobs[5];
 	Eigen::Vector2f pos = {0, 0};
@@ -58,34 +109,12 @@ public:
 	float offsetScore = 1.0f;
 	int botId = -1;
 	int blobAmount = 0;
+	bool tracked = false;
 
 private:
-	inline void calcPos();
-
-	inline void calcOffsetScore();
-};
-
-
-class DetectionBotHypothesis: public BotHypothesis {
-public:
-	DetectionBotHypothesis(const Resources& r, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e);
-
-	void recalcPostColorCalib(const Resources &r) override;
+	BotHypothesis(const Match* a, const Match* b, const Match* c, const Match* d, const Match* e);
 
-private:
 	inline void calcBotId(const Resources& r);
-};
-
-
-class TrackedBotHypothesis: public BotHypothesis {
-public:
-	TrackedBotHypothesis(const Resources& r, const TrackingState& tracked, const Eigen::Vector3f& trackedPosition, const Match* a, const Match* b, const Match* c, const Match* d, const Match* e);
-
-	void recalcPostColorCalib(const Resources &r) override;
 
-private:
 	inline void calcTrackingScore(const Resources& r);
-
-	const float trackedScore;
-	const Eigen::Vector3f trackedPosition;
 };
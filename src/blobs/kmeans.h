@@ -15,7 +15,101 @@
  */
 #pragma once
 
+#include <array>
+#include <bit>
+#include <climits>
 #include <vector>
 #include <eigen3/Eigen/Core>
 
 bool kMeans(const Eigen::Vector3i& contrast, const std::vector<Eigen::Vector3i>& values, Eigen::Vector3i& c1, Eigen::Vector3i& c2);
+
+// Integer division by a cluster size of kMeans<N> with constant divisors instead of idiv instructions
+inline Eigen::Vector3i divideClusterSum(const Eigen::Vector3i& sum, const int n) {
+	switch(n) {
+		case 1: return sum;
+		case 2: return sum / 2;
+		case 3: return sum / 3;
+		case 4: return sum / 4;
+		default: return sum / n;
+	}
+}
+
+/**
+ * Allocation free kMeans for a fixed amount of values (e.g. the 4 side blobs of a bot) with the same result as the
+ * generic version. The cluster sums of all 2^N partitions are enumerated up front, so every iteration only classifies
+ * the values into a partition bitmask and looks up its sums.
+ */
+template<size_t N>
+bool kMeans(const Eigen::Vector3i& contrast, const std::array<Eigen::Vector3i, N>& values, Eigen::Vector3i& c1, Eigen::Vector3i& c2) {
+	static_assert(N >= 2 && N <= 8, "partition enumeration is limited to 2^8 entries");
+
+	int inGroupDiff = INT_MAX;
+	int outGroupDiff = INT_MAX;
+	for(size_t i = 0; i < N; i++) {
+		outGroupDiff = std::min(outGroupDiff, (values[i] - contrast).squaredNorm());
+
+		for(size_t j = i+1; j < N; j++)
+			inGroupDiff = std::min(inGroupDiff, (values[j] - values[i]).squaredNorm());
+	}
+
+	if(inGroupDiff > outGroupDiff)
+		return false;
+
+	const Eigen::Vector3i c1backup = c1;
+	const Eigen::Vector3i c2backup = c2;
+
+	// First value with the smallest distance like std::min_element
+	auto nearest = [&](const Eigen::Vector3i& center) -> const Eigen::Vector3i& {
+		size_t best = 0;
+		for(size_t i = 1; i < N; i++) {
+			if((values[i] - center).squaredNorm() < (values[best] - center).squaredNorm())
+				best = i;
+		}
+		return values[best];
+	};
+	c1 = nearest(c1backup);
+	c2 = nearest(c2backup);
+	if(c1 == c2) {
+		c1 = c1backup;
+		c2 = c2backup;
+		return false;
+	}
+
+	constexpr unsigned int all = (1u << N) - 1;
+	std::array<Eigen::Vector3i, 1u << N> sums;
+	sums[0] = {0, 0, 0};
+	for(unsigned int mask = 1; mask <= all; mask++)
+		sums[mask] = sums[mask & (mask - 1)] + values[std::countr_zero(mask)];
+
+	Eigen::Vector3i oldC1 = c2;
+	Eigen::Vector3i oldC2 = c1;
+	while(oldC1 != c1 && oldC2 != c2) {
+		unsigned int mask = 0;
+		for(size_t i = 0; i < N; i++) {
+			if((values[i] - c1).squaredNorm() < (values[i] - c2).squaredNorm())
+				mask |= 1u << i;
+		}
+
+		const int n1 = std::popcount(mask);
+		if(n1 == 0 || n1 == (int)N) {
+			c1 = c1backup;
+			c2 = c2backup;
+			return false;
+		}
+
+		oldC1 = c1;
+		oldC2 = c2;
+		c1 = divideClusterSum(sums[mask], n1);
+		c2 = divideClusterSum(sums[all ^ mask], (int)N - n1);
+	}
+
+	// |c1 - c2| < sqrt(outGroupDiff)/2 in integers, the norm of an integer vector is truncated
+	const int distance = (c1 - c2).norm();
+	if(4 * distance * distance < outGroupDiff) {
+		c1 = c1backup;
+		c2 = c2backup;
+		return false;
+	}
+
+	return true;
+}
@@ -26,5 +26,10 @@ struct Match {
 	float circ;
 	float score;
 
+	// Color classification against the learned colors, set by classifyColors
+	int blueMargin = 0; // squared distance to yellow minus squared distance to blue, > 0 is blue
+	int greenMargin = 0; // squared distance to pink minus squared distance to green, > 0 is green
+	float orangeScore = 0.0f; // ball color score, 0 if not closer to orange than to the field and field line colors
+
 	auto operator<=>(const Match&) const = default;
 };
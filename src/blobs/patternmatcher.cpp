@@ -0,0 +1,127 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "patternmatcher.h"
+#include "pattern.h"
+#include "fastmath.h"
+
+#include <algorithm>
+#include <cmath>
+
+static inline float ccwGap(const float from, const float to) {
+	const float gap = to - from;
+	return gap < 0.0f ? gap + 2.0f * (float)M_PI : gap;
+}
+
+PatternMatcher::PatternMatcher() {
+	for(int i = 0; i < 5; i++)
+		for(int j = 0; j < 5; j++)
+			patternDistances[i][j] = (patternPos[i] - patternPos[j]).norm();
+
+	for(int i = 0; i < 4; i++)
+		patternGaps[i] = ccwGap(atan2f(patternPos[i+1].y(), patternPos[i+1].x()), atan2f(patternPos[(i+1)%4 + 1].y(), patternPos[(i+1)%4 + 1].x()));
+}
+
+void PatternMatcher::tolerances(const float minConfidence, float& distanceTolerance, float& gapTolerance) {
+	// score > minConfidence requires every blob to be closer than maxOffset to its pattern position,
+	// so any blob distance may deviate at most 2*maxOffset from the pattern
+	const float maxOffset = minConfidence > 0.0f ? 10.0f * sqrtf(1.0f / std::min(minConfidence, 1.0f) - 1.0f) : INFINITY;
+	distanceTolerance = 2.0f * maxOffset + 1.0f; // 1mm slack for rounding
+	// Angular deviation of a side blob seen from the center blob, unbounded if the tolerance exceeds the side distance
+	const float sideDistance = patternPos[1].norm();
+	gapTolerance = distanceTolerance < sideDistance ? 2.0f * asinf(distanceTolerance / sideDistance) : INFINITY;
+}
+
+std::optional<BotHypothesis> PatternMatcher::match(const Resources& r, const Match* center, const std::vector<Match*>& neighbours) {
+	const long n = (long)neighbours.size() - 1; // without the center blob itself
+	if(n >= 3)
+		tried += (n+1) * ((n * (n-1) * (n-2)) / 6);
+
+	float tolerance;
+	float gapTolerance;
+	tolerances(r.minConfidence, tolerance, gapTolerance);
+	const float sideDistance = patternDistances[0][1];
+
+	sorted.clear();
+	diffX.clear();
+	diffY.clear();
+	for(const Match* blob : neighbours) {
+		const Eigen::Vector2f diff = blob->pos - center->pos;
+		const float distance = diff.norm();
+		if(std::abs(distance - sideDistance) < tolerance) {
+			sorted.push_back({0.0f, distance, blob});
+			diffX.push_back(diff.x());
+			diffY.push_back(diff.y());
+		}
+	}
+	if(sorted.size() < 4)
+		return std::nullopt;
+
+	angles.resize(sorted.size());
+	atan2_fast(diffY.data(), diffX.data(), angles.data(), (int)sorted.size());
+	for(size_t i = 0; i < sorted.size(); i++)
+		sorted[i].angle = angles[i];
+
+	std::sort(sorted.begin(), sorted.end(), [](const Neighbour& a, const Neighbour& b) -> bool { return a.angle < b.angle; });
+
+	auto fits = [&](const Neighbour& a, const Neighbour& b, const int i, const int j) -> bool {
+		return std::abs((a.blob->pos - b.blob->pos).norm() - patternDistances[i][j]) < tolerance;
+	};
+	auto gapFits = [&](const Neighbour& a, const Neighbour& b, const int i) -> bool {
+		return std::abs(wrapAngle(ccwGap(a.angle, b.angle) - patternGaps[i])) < gapTolerance;
+	};
+
+	// Candidates are scored in batches, only the best one is classified by color
+	float bestBotScore = 0.0f;
+	const Match* bestBlobs[5] = {nullptr, nullptr, nullptr, nullptr, nullptr};
+	batch.clear();
+	const int size = (int)sorted.size();
+	for(int a = 0; a < size; a++) {
+		const Neighbour& na = sorted[a];
+		for(int b = a+1; b < a+size-2; b++) {
+			const Neighbour& nb = sorted[b%size];
+			if(!fits(na, nb, 1, 2) || !gapFits(na, nb, 0))
+				continue;
+
+			for(int c = b+1; c < a+size-1; c++) {
+				const Neighbour& nc = sorted[c%size];
+				if(!fits(nb, nc, 2, 3) || !fits(na, nc, 1, 3) || !gapFits(nb, nc, 1))
+					continue;
+
+				for(int d = c+1; d < a+size; d++) {
+					const Neighbour& nd = sorted[d%size];
+					if(!fits(nc, nd, 3, 4) || !fits(na, nd, 1, 4) || !fits(nb, nd, 2, 4) || !gapFits(nc, nd, 2) || !gapFits(nd, na, 3))
+						continue;
+
+					scored++;
+					batch.push(center, na.blob, nb.blob, nc.blob, nd.blob);
+					if(batch.full()) {
+						batch.evaluate();
+						batch.selectBest(bestBotScore, bestBlobs);
+					}
+				}
+			}
+		}
+	}
+	if(batch.size > 0) {
+		batch.evaluate();
+		batch.selectBest(bestBotScore, bestBlobs);
+	}
+
+	if(bestBotScore <= 0.0f)
+		return std::nullopt;
+
+	return BotHypothesis(r, bestBlobs[0], bestBlobs[1], bestBlobs[2], bestBlobs[3], bestBlobs[4]);
+}
@@ -0,0 +1,57 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+#include <optional>
+#include <vector>
+#include "hypothesis.h"
+
+/**
+ * Enumerates the angle sorted side blob quadruples around a center blob like an exhaustive search, but only fully
+ * scores quadruples whose pairwise distances and angular gaps are compatible with the pattern geometry for a score
+ * above minConfidence. Quadruples that are skipped could not have passed filterHypothesesScore.
+ */
+class PatternMatcher {
+public:
+	PatternMatcher();
+
+	/** Best scoring hypothesis for center with the neighbours from rangeSearch, empty if none could reach minConfidence. */
+	std::optional<BotHypothesis> match(const Resources& r, const Match* center, const std::vector<Match*>& neighbours);
+
+	void resetStats() { tried = 0; scored = 0; }
+
+	/** Blob distance and angular gap deviations from the pattern that still allow a score above minConfidence. */
+	static void tolerances(float minConfidence, float& distanceTolerance, float& gapTolerance);
+
+	long tried = 0; // combinations of the exhaustive search
+	long scored = 0; // fully scored combinations
+
+private:
+	struct Neighbour {
+		float angle;
+		float distance;
+		const Match* blob;
+	};
+
+	std::vector<Neighbour> sorted;
+	std::vector<float> diffX;
+	std::vector<float> diffY;
+	std::vector<float> angles;
+	BotGeometryBatch batch;
+
+	float patternDistances[5][5];
+	float patternGaps[4]; // counterclockwise angle from side blob i to i+1 seen from the center blob
+};
@@ -0,0 +1,134 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "trackedmatcher.h"
+#include "pattern.h"
+
+#include <algorithm>
+
+// Relative slack for float rounding of the evaluated scores against the bounds
+static const float BOUND_SLACK = 1.0001f;
+
+TrackedMatcher::TrackedMatcher() {
+	for(int i = 0; i < 5; i++)
+		for(int j = 0; j < 5; j++)
+			patternDistances[i][j] = (patternPos[i] - patternPos[j]).norm();
+}
+
+std::optional<BotHypothesis> TrackedMatcher::match(const Resources& r, const TrackingState& tracked, const Eigen::Vector3f& trackedPos, const std::vector<Match*> candidates[5], const Eigen::Vector2f positions[5]) {
+	long combinations = 1;
+	for(int i = 0; i < 5; i++) {
+		slots[i].clear();
+		// Blobs with the wrong color would result in a score of 0
+		for(const Match* blob : candidates[i]) {
+			if(blob != nullptr && BotHypothesis::colorMatches(tracked.id, i, blob))
+				slots[i].push_back({(blob->pos - positions[i]).norm(), blob});
+		}
+		std::sort(slots[i].begin(), slots[i].end(), [](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+		slots[i].push_back({0.0f, nullptr});
+		combinations *= (long)slots[i].size();
+	}
+	tried += combinations;
+
+	remainingBlobs[5] = 0;
+	for(int i = 4; i >= 0; i--)
+		remainingBlobs[i] = remainingBlobs[i+1] + (slots[i].size() > 1);
+
+	trackedPosition = trackedPos;
+	evaluationLimit = r.maxTrackedEvaluations;
+	evaluations = 0;
+	bestScore = 0.0f;
+	std::fill(best, best + 5, nullptr);
+	batch.clear();
+
+	search(0, 0, 1.0f);
+	if(batch.size > 0)
+		flush();
+	if(evaluations >= evaluationLimit)
+		capped++;
+
+	if(bestScore <= 0.0f)
+		return std::nullopt;
+
+	return std::make_optional<BotHypothesis>(r, tracked, trackedPosition, best[0], best[1], best[2], best[3], best[4]);
+}
+
+void TrackedMatcher::flush() {
+	batch.evaluate();
+	batch.applyTracking(trackedPosition);
+	batch.selectBest(bestScore, best);
+}
+
+/*
+ * The score of a complete combination is offsetScore * trackingFactor with
+ *   offsetScore    = min over blobs of 1/(1 + |residual/10|²), residual: blob to its fitted pattern position
+ *   trackingFactor = blobAmount/5 / (1 + |pos - tracked|²/100 + rotationOffset²) <= blobAmount/5
+ * Two blobs deviating by dev from their pattern distance need a residual of at least dev/2 on one of them, the center
+ * blob at distance d from the tracked position needs |residual| + |pos - tracked| >= d. Both bound the score of every
+ * completion of a partial combination, blobAmount is bounded by the positions that still have candidate blobs.
+ */
+void TrackedMatcher::search(const int slot, const int blobAmount, const float offsetBound) {
+	if(slot == 5) {
+		// Combinations with less than 2 blobs would result in a score of 0
+		if(blobAmount < 2)
+			return;
+
+		batch.push(assignment[0], assignment[1], assignment[2], assignment[3], assignment[4]);
+		scored++;
+		evaluations++;
+		if(batch.full())
+			flush();
+		return;
+	}
+
+	for(const Candidate& candidate : slots[slot]) {
+		if(evaluations >= evaluationLimit)
+			return;
+
+		const Match* blob = candidate.blob;
+		float bound = offsetBound;
+		bool duplicate = false;
+		if(blob != nullptr) {
+			if(slot == 0) {
+				const float d = candidate.distance / 10.0f;
+				bound = std::min(bound, 1.0f / (1.0f + d*d / 2.0f));
+			}
+
+			for(int i = 0; i < slot; i++) {
+				const Match* other = assignment[i];
+				if(other == nullptr)
+					continue;
+
+				if(other == blob) {
+					duplicate = true;
+					break;
+				}
+
+				const float dev = ((blob->pos - other->pos).norm() - patternDistances[slot][i]) / 20.0f;
+				bound = std::min(bound, 1.0f / (1.0f + dev*dev));
+			}
+		}
+		if(duplicate)
+			continue;
+
+		const int amount = blobAmount + (blob != nullptr);
+		const int maxAmount = amount + remainingBlobs[slot+1];
+		if(maxAmount < 2 || (float)maxAmount / 5.0f * bound * BOUND_SLACK <= bestScore)
+			continue;
+
+		assignment[slot] = blob;
+		search(slot + 1, amount, bound);
+	}
+}
@@ -0,0 +1,61 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+#include <optional>
+#include <vector>
+#include "hypothesis.h"
+
+/**
+ * Branch and bound search for the blobs of a tracked bot with the same result as scoring every combination of the
+ * rangeSearch candidates. Candidates of each pattern position are visited closest to the predicted position first,
+ * partial combinations are dropped as soon as an upper bound of their score cannot exceed the best one found.
+ */
+class TrackedMatcher {
+public:
+	TrackedMatcher();
+
+	/** Best scoring hypothesis for tracked with the candidates of each pattern position (nullptr entries are ignored). */
+	std::optional<BotHypothesis> match(const Resources& r, const TrackingState& tracked, const Eigen::Vector3f& trackedPosition, const std::vector<Match*> candidates[5], const Eigen::Vector2f positions[5]);
+
+	void resetStats() { tried = 0; scored = 0; capped = 0; }
+
+	long tried = 0; // combinations of the exhaustive search
+	long scored = 0; // fully scored combinations
+	long capped = 0; // searches stopped by maxTrackedEvaluations
+
+private:
+	struct Candidate {
+		float distance; // to the predicted position
+		const Match* blob;
+	};
+
+	void search(int slot, int blobAmount, float offsetBound);
+	void flush();
+
+	std::vector<Candidate> slots[5]; // nullptr (no blob) last
+	int remainingBlobs[6]; // positions from slot on with at least one candidate blob
+	const Match* assignment[5];
+
+	Eigen::Vector3f trackedPosition;
+	int evaluationLimit;
+	int evaluations;
+	float bestScore;
+	const Match* best[5];
+	BotGeometryBatch batch;
+
+	float patternDistances[5][5];
+};
@@ -42,6 +42,10 @@ CameraConfig::CameraConfig(const YAML::Node &cam) {
 	exposure = cam["exposure"].as<double>(0.0);
 	gain = cam["gain"].as<double>(0.0);
 	gamma = cam["gamma"].as<double>(1.0);
+	bitDepth = cam["bit_depth"].as<int>(8);
+	if(bitDepth != 8 && bitDepth != 10 && bitDepth != 12) {
+		FATAL("Invalid camera bit depth, must be 8, 10 or 12: " << bitDepth);
+	}
 
 	const YAML::Node wb = cam["white_balance"].IsDefined() ? cam["white_balance"] : YAML::Node();
 	if(wb.IsMap()) {
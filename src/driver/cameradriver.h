@@ -44,6 +44,10 @@ public:
 
 	// Bound to the driver for reproducibility during testing with files.
 	virtual double getTime();
+
+	// Latches the camera clock in the domain of RawImage::timestamp, false if unsupported
+	// Called from the latency sampler thread concurrently to readImage, implementations have to be thread safe
+	virtual bool latchTime(double& cameraTime) { return false; }
 };
 
 
@@ -67,6 +71,7 @@ public:
 	double exposure;
 	double gain;
 	double gamma;
+	int bitDepth; // Raw Bayer sample depth, 10 and 12 use packed transfer formats where supported
 
 	WhiteBalanceType whiteBalanceType = WhiteBalanceType_Manual;
 	double whiteBalanceBlue;
@@ -21,7 +21,9 @@
 
 class MVImpactImage : public RawImage {
 public:
-	explicit MVImpactImage(const std::shared_ptr<Request>& request): RawImage(&PixelFormat::GRBG8, request->imageWidth.read() / 2, request->imageHeight.read() / 2, (double)request->infoTimeStamp_us.read() / 1e6, (uint8_t*)request->imageData.read()), request(request) {}
+	explicit MVImpactImage(const std::shared_ptr<Request>& request): RawImage(&PixelFormat::GRBG8, request->imageWidth.read() / 2, request->imageHeight.read() / 2, (double)request->infoTimeStamp_us.read() / 1e6, (uint8_t*)request->imageData.read()), request(request) {
+		deliveryTime = getRealTime();
+	}
 
 private:
 	std::shared_ptr<Request> request;
@@ -24,6 +24,7 @@ class SpinnakerImage : public RawImage {
 public:
 	SpinnakerImage(SpinnakerDriver& source, const Spinnaker::ImagePtr& pImage): RawImage(*source.borrow(pImage)), source(source), pImage(pImage) {
 		timestamp = (double)pImage->GetTimeStamp() / 1e9;
+		deliveryTime = getRealTime();
 	}
 
 	~SpinnakerImage() override {
@@ -61,7 +62,15 @@ SpinnakerDriver::SpinnakerDriver(const CameraConfig& config) {
 
 	CATCH_SPINNAKER(pCam->TriggerMode.SetValue(Spinnaker::TriggerMode_Off))
 	CATCH_SPINNAKER(pCam->AcquisitionMode.SetValue(Spinnaker::AcquisitionMode_Continuous))
-	CATCH_SPINNAKER(pCam->PixelFormat.SetValue(Spinnaker::PixelFormat_BayerRG8))
+	if(config.bitDepth == 12) {
+		pixelFormat = &PixelFormat::RGGB12P;
+		CATCH_SPINNAKER(pCam->PixelFormat.SetValue(Spinnaker::PixelFormat_BayerRG12p))
+	} else if(config.bitDepth == 10) {
+		pixelFormat = &PixelFormat::RGGB10P;
+		CATCH_SPINNAKER(pCam->PixelFormat.SetValue(Spinnaker::PixelFormat_BayerRG10p))
+	} else {
+		CATCH_SPINNAKER(pCam->PixelFormat.SetValue(Spinnaker::PixelFormat_BayerRG8))
+	}
 	CATCH_SPINNAKER(pCam->AcquisitionFrameRateEnable.SetValue(false))
 
 	if(config.autoResolution()) {
@@ -119,9 +128,10 @@ SpinnakerDriver::SpinnakerDriver(const CameraConfig& config) {
 	// Provide image buffers to achieve faster mapping with OpenCL
 	int width = pCam->WidthMax.GetValue();
 	int height = pCam->HeightMax.GetValue();
+	int bufferSize = width/2 * height/2 * pixelFormat->pixelSize();
 	for(int i = 0; i < pCam->TLStream.StreamBufferCountManual.GetMin(); i++) {
 		// Spinnaker buffer sizes need to be 1024 byte aligned
-		std::shared_ptr<RawImage> buffer = std::make_shared<RawImage>(CLArray((width * height + 1023)/1024 * 1024), &PixelFormat::RGGB8, width/2, height/2, "spinnaker");
+		std::shared_ptr<RawImage> buffer = std::make_shared<RawImage>(CLArray((bufferSize + 1023)/1024 * 1024), pixelFormat, width/2, height/2, "spinnaker");
 		buffers[buffer] = std::make_unique<CLMap<uint8_t>>(buffer->write<uint8_t>());
 	}
 
@@ -130,7 +140,7 @@ SpinnakerDriver::SpinnakerDriver(const CameraConfig& config) {
 		bufferPtrs.push_back(**item.second);
 
 	pCam->SetBufferOwnership(Spinnaker::SPINNAKER_BUFFER_OWNERSHIP_USER);
-	pCam->SetUserBuffers(bufferPtrs.data(), buffers.size(), width*height);
+	pCam->SetUserBuffers(bufferPtrs.data(), buffers.size(), bufferSize);
 	//pCam->Timestamp.SetValue();
 
 	if (IsWritable(pCam->GevSCPSPacketSize)) {
@@ -145,13 +155,28 @@ std::shared_ptr<RawImage> SpinnakerDriver::readImage() {
 }
 
 const PixelFormat SpinnakerDriver::format() {
-	return PixelFormat::RGGB8;
+	return *pixelFormat;
 }
 
 double SpinnakerDriver::expectedFrametime() {
+	std::unique_lock<std::mutex> lock(nodeMutex);
 	return 1 / pCam->AcquisitionResultingFrameRate.GetValue();
 }
 
+bool SpinnakerDriver::latchTime(double& cameraTime) {
+	std::unique_lock<std::mutex> lock(nodeMutex);
+	if(!IsWritable(pCam->TimestampLatch) || !IsReadable(pCam->TimestampLatchValue))
+		return false;
+
+	try {
+		pCam->TimestampLatch.Execute();
+		cameraTime = (double)pCam->TimestampLatchValue.GetValue() / 1e9;
+		return true;
+	} catch (Spinnaker::Exception &e) {
+		return false;
+	}
+}
+
 SpinnakerDriver::~SpinnakerDriver() {
 	pCam->EndAcquisition();
 }
@@ -166,7 +191,7 @@ std::shared_ptr<RawImage> SpinnakerDriver::borrow(const Spinnaker::ImagePtr& pIm
 	}
 
 	WARN("Did not get image with given buffer, creating new buffer; expect OpenCL performance degradation");
-	std::shared_ptr<RawImage> image = std::make_shared<RawImage>(&PixelFormat::RGGB8, (int)pImage->GetWidth() / 2, (int)pImage->GetHeight() / 2, (unsigned char*)pImage->GetData());
+	std::shared_ptr<RawImage> image = std::make_shared<RawImage>(pixelFormat, (int)pImage->GetWidth() / 2, (int)pImage->GetHeight() / 2, (unsigned char*)pImage->GetData());
 	pImage->Release();
 	return image;
 }
@@ -16,6 +16,7 @@
 #pragma once
 #ifdef SPINNAKER
 
+#include <mutex>
 #include "cameradriver.h"
 #include "Spinnaker.h"
 
@@ -30,12 +31,17 @@ public:
 
 	double expectedFrametime() override;
 
+	bool latchTime(double& cameraTime) override;
+
 	std::shared_ptr<RawImage> borrow(const Spinnaker::ImagePtr& pImage);
 	void restore(const RawImage& image);
 
 private:
 	Spinnaker::SystemPtr pSystem;
 	Spinnaker::CameraPtr pCam;
+	const PixelFormat* pixelFormat = &PixelFormat::RGGB8;
+	// Serializes node map access of latchTime (latency sampler thread) and the processing thread, GetNextImage only uses the stream
+	std::mutex nodeMutex;
 
 	std::map<std::shared_ptr<RawImage>, std::unique_ptr<CLMap<uint8_t>>> buffers; // Use own image buffers for page size alignment (OpenCL pinned memory and zero copy)
 };
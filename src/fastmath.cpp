@@ -0,0 +1,31 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "fastmath.h"
+
+void atan2_fast(const float* __restrict y, const float* __restrict x, float* __restrict out, const int n) {
+	for(int i = 0; i < n; i++)
+		out[i] = atan2_fast(y[i], x[i]);
+}
+
+void sincos_fast(const float* __restrict angle, float* __restrict sin, float* __restrict cos, const int n) {
+	for(int i = 0; i < n; i++)
+		sincos_fast(angle[i], sin[i], cos[i]);
+}
+
+void wrapAngle(const float* __restrict angle, float* __restrict out, const int n) {
+	for(int i = 0; i < n; i++)
+		out[i] = wrapAngle(angle[i]);
+}
@@ -0,0 +1,92 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+#include <cmath>
+
+/*
+ * Float approximations for the hypothesis hot path. The scalar variants are inline and branch free, loops over them are
+ * vectorized by the compiler. The array variants are such loops for callers that already hold structure of arrays data.
+ * Maximum absolute errors against double precision as measured by math_benchmark:
+ *   atan2_fast   1.0e-5 rad (2.0e-6 measured)
+ *   sincos_fast  1.2e-7 for |angle| <= 2^13, undefined beyond
+ *   wrapAngle    2.4e-7 rad (1 ulp at pi), [-pi, pi] like remainderf(angle, 2*pi)
+ */
+
+// Round to nearest (halfway away from zero) via truncation, which vectorizes without SSE4.1 and survives -ffast-math
+inline float roundNearest(const float x) {
+	return (float)(int)(x + copysignf(0.5f, x));
+}
+
+//atan2 implementation adapted from: https://mazzo.li/posts/vectorized-atan2.html https://gist.github.com/bitonic/d0f5a0a44e37d4f0be03d34d47acb6cf
+inline float atan_fma_approximation(const float x) {
+	const float a1  =  0.99997726f;
+	const float a3  = -0.33262347f;
+	const float a5  =  0.19354346f;
+	const float a7  = -0.11643287f;
+	const float a9  =  0.05265332f;
+	const float a11 = -0.01172120f;
+
+	// Compute approximation using Horner's method, contracted to fma instructions if available (fmaf is a library call otherwise)
+	const float x_sq = x*x;
+	return x * (a1 + x_sq*(a3 + x_sq*(a5 + x_sq*(a7 + x_sq*(a9 + x_sq*a11)))));
+}
+
+inline float atan2_fast(const float y, const float x) {
+	const float pi = M_PI;
+	const float pi_2 = M_PI_2;
+
+	// Ensure input is in [-1, +1], atan2(0, 0) is 0
+	const bool swap = fabsf(x) < fabsf(y);
+	const float divisor = swap ? y : x;
+	const float dividend = swap ? x : y;
+	const float atan_input = divisor == 0.0f ? 0.0f : dividend / divisor;
+
+	// Approximate atan
+	float res = atan_fma_approximation(atan_input);
+
+	// If swapped, adjust atan output
+	res = swap ? copysignf(pi_2, atan_input) - res : res;
+	// Adjust the result depending on the input quadrant
+	return x < 0.0f ? copysignf(pi, y) + res : res;
+}
+
+// Reduction to [-pi/4, pi/4] in double precision, which unlike a Cody-Waite split survives -ffast-math reassociation,
+// and the cephes sinf/cosf polynomials
+inline void sincos_fast(const float angle, float& sin, float& cos) {
+	const float quadrant = roundNearest(angle * (float)M_2_PI);
+	const float x = (float)((double)angle - (double)quadrant * M_PI_2);
+	const float x2 = x*x;
+
+	const float s = x + x*x2 * (-1.6666654611e-1f + x2*(8.3321608736e-3f + x2*-1.9515295891e-4f));
+	const float c = 1.0f - 0.5f*x2 + x2*x2 * (4.166664568298827e-2f + x2*(-1.388731625493765e-3f + x2*2.443315711809948e-5f));
+
+	const int q = (int)quadrant;
+	const float swappedSin = (q & 1) ? c : s;
+	const float swappedCos = (q & 1) ? s : c;
+	sin = (q & 2) ? -swappedSin : swappedSin;
+	cos = ((q + 1) & 2) ? -swappedCos : swappedCos;
+}
+
+inline float wrapAngle(const float angle) {
+	return (float)((double)angle - 2.0 * M_PI * (double)roundNearest(angle * (float)(0.5 * M_1_PI)));
+}
+
+void atan2_fast(const float* y, const float* x, float* out, int n);
+
+void sincos_fast(const float* angle, float* sin, float* cos, int n);
+
+void wrapAngle(const float* angle, float* out, int n);
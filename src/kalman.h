@@ -0,0 +1,65 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+/**
+ * Kalman filter of a single coordinate with a constant velocity model. The process noise is white noise acceleration
+ * with the variance accelerationVariance, the measurement noise has the variance measurementVariance.
+ */
+struct KalmanAxis {
+	float position = 0.0f;
+	float velocity = 0.0f;
+	float covariance[3] = {0.0f, 0.0f, 0.0f}; // position², position*velocity, velocity²
+
+	void reset(const float measurement, const float measurementVariance, const float velocityVariance) {
+		position = measurement;
+		velocity = 0.0f;
+		covariance[0] = measurementVariance;
+		covariance[1] = 0.0f;
+		covariance[2] = velocityVariance;
+	}
+
+	void predict(const float dt, const float accelerationVariance) {
+		const float dt2 = dt*dt;
+		position += velocity * dt;
+		covariance[0] = predictedVariance(covariance, dt, accelerationVariance);
+		covariance[1] += dt * covariance[2] + accelerationVariance * dt2 * dt / 2.0f;
+		covariance[2] += accelerationVariance * dt2;
+	}
+
+	/** Variance of the innovation (measurement - position). */
+	[[nodiscard]] float innovationVariance(const float measurementVariance) const {
+		return covariance[0] + measurementVariance;
+	}
+
+	/** Innovation is passed explicitly to allow wrapped angles. */
+	void update(const float innovation, const float measurementVariance) {
+		const float s = innovationVariance(measurementVariance);
+		const float kPosition = covariance[0] / s;
+		const float kVelocity = covariance[1] / s;
+		position += kPosition * innovation;
+		velocity += kVelocity * innovation;
+		covariance[2] -= kVelocity * covariance[1];
+		covariance[1] *= 1.0f - kPosition;
+		covariance[0] *= 1.0f - kPosition;
+	}
+
+	/** Position variance of covariance after dt without an update. */
+	static float predictedVariance(const float covariance[3], const float dt, const float accelerationVariance) {
+		const float dt2 = dt*dt;
+		return covariance[0] + 2.0f * dt * covariance[1] + dt2 * covariance[2] + accelerationVariance * dt2 * dt2 / 4.0f;
+	}
+};
@@ -0,0 +1,91 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "Resources.h"
+
+static const char* engineName(BlobCenterEngine engine) {
+	return engine == BlobCenterEngine_Box ? "BOX" : "SAT";
+}
+
+static double runEngine(Resources& r, BlobCenterEngine engine, const cl::Event& gradDotEvent, const CLImage& gradDot, CLImage& blobCenter) {
+	r.openCl->clearEvents();
+	r.gradDot2blobCenter(engine, gradDotEvent, gradDot, blobCenter);
+	double runtime = r.openCl->sumRuntimes();
+	r.openCl->clearEvents();
+	return runtime;
+}
+
+int main(int argc, char* argv[]) {
+	Resources r(argc > 1 ? argv[1] : "config.yml");
+	const BlobCenterEngine engines[2] = {BlobCenterEngine_SAT, BlobCenterEngine_Box};
+
+	int frameId = 0;
+	double runtimeSum[2] = {0.0, 0.0};
+	double maxDiff = 0.0;
+	double diffSum = 0.0;
+	long diffAmount = 0;
+
+	while(true) {
+		std::shared_ptr<RawImage> img = r.camera->readImage();
+		if(img == nullptr)
+			break;
+
+		r.perspective->geometryCheck(img->width, img->height, r.gcSocket->maxBotHeight, r.resamplingFactor);
+		if(!r.perspective->geometryVersion) {
+			WARN("No geometry available, skipping frame");
+			continue;
+		}
+
+		std::shared_ptr<CLImage> channels[4];
+		r.raw2quad(*img, channels);
+		std::shared_ptr<CLImage> flat;
+		std::shared_ptr<CLImage> gradDot;
+		std::shared_ptr<CLImage> blobCenter;
+		r.rgba2blobCenter(channels, flat, gradDot, blobCenter);
+		r.openCl->clearEvents();
+
+		cl::Event gradDotEvent = r.openCl->run(r.gradientDot, cl::EnqueueArgs(cl::NDRange(gradDot->width, gradDot->height)), flat->image, gradDot->image, r.processingMask->buffer);
+		OpenCL::wait(gradDotEvent);
+
+		std::shared_ptr<CLImage> results[2];
+		for(int i = 0; i < 2; i++) {
+			results[i] = r.openCl->acquire(&PixelFormat::F32, gradDot->width, gradDot->height, gradDot->name);
+			runtimeSum[i] += runEngine(r, engines[i], gradDotEvent, *gradDot, *results[i]);
+		}
+
+		// The SAT reads clamped prefix sums at the image border, only the interior is comparable
+		const int border = (int)ceilf(r.perspective->minBlobRadius / r.perspective->fieldScale) + 1;
+		CLImageMap<float> sat = results[0]->read<float>();
+		CLImageMap<float> box = results[1]->read<float>();
+		for(int y = border; y < gradDot->height - border; y++) {
+			for(int x = border; x < gradDot->width - border; x++) {
+				double diff = std::abs(sat(x, y) - box(x, y));
+				maxDiff = std::max(maxDiff, diff);
+				diffSum += diff;
+				diffAmount++;
+			}
+		}
+
+		frameId++;
+	}
+
+	if(frameId == 0 || diffAmount == 0)
+		FATAL("No frames with geometry processed, nothing to compare");
+
+	for(int i = 0; i < 2; i++)
+		std::cout << "[Kernel benchmark] " << engineName(engines[i]) << " blob center avg runtime: " << (runtimeSum[i] / frameId) << " ms" << std::endl;
+	std::cout << "[Kernel benchmark] Automatic engine selection: " << engineName(r.activeBlobCenterEngine()) << std::endl;
+	std::cout << "[Kernel benchmark] SAT/BOX difference avg: " << (diffSum / (double)diffAmount) << " max: " << maxDiff << " frames: " << frameId << std::endl;
+}
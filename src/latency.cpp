@@ -0,0 +1,210 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "latency.h"
+#include "log.h"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// Camera clock sample interval and lower envelope block length in s
+static const double CLOCK_INTERVAL = 1.0;
+// Clock mapping errors above this are camera restarts or clock resets
+static const double CLOCK_RESET = 1.0;
+static const double REPORT_INTERVAL = 10.0;
+
+void CameraClock::addSample(const double cameraTime, const double realTime) {
+	if(sampleAmount == 0)
+		reference = cameraTime;
+
+	cameraTimes[nextSample] = cameraTime - reference;
+	offsets[nextSample] = realTime - cameraTime;
+	nextSample = (nextSample + 1) % SAMPLES;
+	sampleAmount = std::min(sampleAmount + 1, SAMPLES);
+
+	double meanX = 0.0;
+	double meanY = 0.0;
+	for(int i = 0; i < sampleAmount; i++) {
+		meanX += cameraTimes[i];
+		meanY += offsets[i];
+	}
+	meanX /= sampleAmount;
+	meanY /= sampleAmount;
+
+	double covariance = 0.0;
+	double variance = 0.0;
+	for(int i = 0; i < sampleAmount; i++) {
+		covariance += (cameraTimes[i] - meanX) * (offsets[i] - meanY);
+		variance += (cameraTimes[i] - meanX) * (cameraTimes[i] - meanX);
+	}
+
+	drift = variance > 0.0 ? covariance / variance : 0.0;
+	offset = meanY - drift * meanX;
+}
+
+void CameraClock::reset() {
+	sampleAmount = 0;
+	nextSample = 0;
+	offset = 0.0;
+	drift = 0.0;
+}
+
+double CameraClock::toRealTime(const double cameraTime) const {
+	return cameraTime + offset + drift * (cameraTime - reference);
+}
+
+
+void LatencyWindow::add(const double latency) {
+	if((int)values.size() < CAPACITY) {
+		values.push_back(latency);
+	} else {
+		values[next] = latency;
+		next = (next + 1) % CAPACITY;
+	}
+}
+
+void LatencyWindow::percentiles(double result[4]) const {
+	if(values.empty()) {
+		std::fill(result, result + 4, NAN);
+		return;
+	}
+
+	std::vector<double> sorted = values;
+	std::sort(sorted.begin(), sorted.end());
+	const double quantiles[3] = {0.5, 0.9, 0.99};
+	for(int i = 0; i < 3; i++)
+		result[i] = sorted[(size_t)(quantiles[i] * (double)(sorted.size() - 1))] * 1000.0;
+	result[3] = sorted.back() * 1000.0;
+}
+
+
+LatencyTelemetry::LatencyTelemetry(CameraDriver& camera): exposureToDelivery("exposure->delivery"), deliveryToProcessing("delivery->processing"), processing("processing"), processingToSend("processing->send"), exposureToSend("exposure->send") {
+	sampler = std::thread(&LatencyTelemetry::sampleRun, this, std::ref(camera));
+}
+
+LatencyTelemetry::~LatencyTelemetry() {
+	{
+		std::unique_lock<std::mutex> lock(samplerMutex);
+		stopSampling = true;
+		samplerSignal.notify_one();
+	}
+	sampler.join();
+}
+
+void LatencyTelemetry::sampleRun(CameraDriver& camera) {
+	std::unique_lock<std::mutex> lock(samplerMutex);
+	while(!samplerSignal.wait_for(lock, std::chrono::duration<double>(CLOCK_INTERVAL), [&]() { return stopSampling; })) {
+		double cameraTime;
+		const double before = getRealTime();
+		if(!camera.latchTime(cameraTime))
+			return; // Unsupported, the lower envelope is used
+
+		const double realTime = (before + getRealTime()) / 2.0;
+		const uint64_t n = latchWritten.load(std::memory_order_relaxed);
+		LatchSample& sample = latchSamples[n % latchSamples.size()];
+		sample.sequence.store(2*n + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		sample.cameraTime.store(cameraTime, std::memory_order_relaxed);
+		sample.realTime.store(realTime, std::memory_order_relaxed);
+		sample.sequence.store(2*n + 2, std::memory_order_release);
+		latchWritten.store(n + 1, std::memory_order_release);
+	}
+}
+
+void LatencyTelemetry::applySamples() {
+	const uint64_t written = latchWritten.load(std::memory_order_acquire);
+	// Slots before the last latchSamples.size() samples have been reused while no frames were processed
+	if(written - latchRead > latchSamples.size())
+		latchRead = written - latchSamples.size();
+
+	for(; latchRead != written; latchRead++) {
+		const LatchSample& sample = latchSamples[latchRead % latchSamples.size()];
+		const uint64_t expected = 2*latchRead + 2;
+		if(sample.sequence.load(std::memory_order_acquire) != expected)
+			continue;
+
+		const double cameraTime = sample.cameraTime.load(std::memory_order_relaxed);
+		const double realTime = sample.realTime.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if(sample.sequence.load(std::memory_order_relaxed) != expected)
+			continue; // Overwritten while reading
+
+		if(!latched)
+			clock.reset();
+		latched = true;
+		clock.addSample(cameraTime, realTime);
+	}
+}
+
+void LatencyTelemetry::frame(const RawImage& img, const double processingStart, const double processingEnd, const double sendEnd) {
+	applySamples();
+
+	const double delivery = img.deliveryTime != 0.0 ? img.deliveryTime : processingStart;
+
+	if(img.timestamp != 0.0) {
+		if(clock.valid() && std::abs(delivery - clock.toRealTime(img.timestamp)) > CLOCK_RESET) {
+			WARN("Camera clock jumped, resetting latency clock mapping");
+			clock.reset();
+			latched = false;
+		}
+
+		if(!latched) {
+			if(delivery - img.timestamp < blockMinOffset) {
+				blockMinOffset = delivery - img.timestamp;
+				blockCameraTime = img.timestamp;
+			}
+
+			if(delivery - blockStart >= CLOCK_INTERVAL) {
+				if(blockMinOffset != INFINITY)
+					clock.addSample(blockCameraTime, blockCameraTime + blockMinOffset);
+				blockStart = delivery;
+				blockMinOffset = INFINITY;
+			}
+		}
+
+		if(clock.valid()) {
+			const double exposure = clock.toRealTime(img.timestamp);
+			exposureToDelivery.add(delivery - exposure);
+			exposureToSend.add(sendEnd - exposure);
+		}
+	}
+
+	deliveryToProcessing.add(processingStart - delivery);
+	processing.add(processingEnd - processingStart);
+	processingToSend.add(sendEnd - processingEnd);
+
+	if(lastReport == 0.0) {
+		lastReport = sendEnd;
+	} else if(sendEnd - lastReport >= REPORT_INTERVAL) {
+		report();
+		lastReport = sendEnd;
+	}
+}
+
+void LatencyTelemetry::report() {
+	std::stringstream line;
+	line << "latency p50/p90/p99/max ms";
+	for(const LatencyWindow* window : {&exposureToDelivery, &deliveryToProcessing, &processing, &processingToSend}) {
+		double p[4];
+		window->percentiles(p);
+		line << " " << window->name << " " << p[0] << "/" << p[1] << "/" << p[2] << "/" << p[3];
+	}
+	LOG(line.str() << " camera clock drift " << clock.driftPpm() << " ppm" << (latched ? "" : " (lower envelope)"));
+
+	double p[4];
+	exposureToSend.percentiles(p);
+	LOG("exposure->send latency p50 " << p[0] << " ms p90 " << p[1] << " ms p99 " << p[2] << " ms max " << p[3] << " ms");
+}
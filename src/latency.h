@@ -0,0 +1,128 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "driver/cameradriver.h"
+
+/**
+ * Linear mapping of a camera clock to getRealTime(): realTime = cameraTime + offset + drift * (cameraTime - reference),
+ * least squares fit over the latest samples.
+ */
+class CameraClock {
+public:
+	void addSample(double cameraTime, double realTime);
+	void reset();
+
+	[[nodiscard]] bool valid() const { return sampleAmount >= 2; }
+	[[nodiscard]] double toRealTime(double cameraTime) const;
+	[[nodiscard]] double driftPpm() const { return drift * 1e6; }
+
+private:
+	static constexpr int SAMPLES = 64;
+
+	double cameraTimes[SAMPLES];
+	double offsets[SAMPLES];
+	int sampleAmount = 0;
+	int nextSample = 0;
+
+	double reference = 0.0;
+	double offset = 0.0;
+	double drift = 0.0;
+};
+
+/** Rolling window of the latest latencies of one stage. */
+class LatencyWindow {
+public:
+	explicit LatencyWindow(const char* name): name(name) { values.reserve(CAPACITY); }
+
+	void add(double latency);
+
+	/** p50/p90/p99/max in ms, sorts a copy of the window. */
+	void percentiles(double result[4]) const;
+
+	const char* const name;
+
+private:
+	static constexpr int CAPACITY = 4096;
+
+	std::vector<double> values;
+	int next = 0;
+};
+
+/**
+ * Latency of each frame from sensor exposure to the return of the detection send syscall:
+ *   exposure -> delivery: RawImage::timestamp mapped to getRealTime() until RawImage::deliveryTime
+ *   delivery -> processing start, processing, processing -> send (t_sent stamping, serialization and sendto)
+ * The camera clock is mapped by samples of CameraDriver::latchTime if the driver supports it. Otherwise it is mapped by
+ * the lower envelope of delivery - timestamp, then exposure -> delivery is the latency above the fastest delivered frame.
+ */
+class LatencyTelemetry {
+public:
+	/** Samples the camera clock about once per second on its own thread if the driver supports it. */
+	explicit LatencyTelemetry(CameraDriver& camera);
+	~LatencyTelemetry();
+
+	void frame(const RawImage& img, double processingStart, double processingEnd, double sendEnd);
+
+	/** Logs the rolling percentiles of all stages. */
+	void report();
+
+	LatencyWindow exposureToDelivery;
+	LatencyWindow deliveryToProcessing;
+	LatencyWindow processing;
+	LatencyWindow processingToSend;
+	LatencyWindow exposureToSend; // headline figure
+
+	CameraClock clock;
+
+private:
+	/** Latches the camera clock, a register round trip to the camera which must not delay frame processing. */
+	void sampleRun(CameraDriver& camera);
+	/** Adds the samples published by sampleRun to clock. */
+	void applySamples();
+
+	// Sample n is stored in slot n % size, its sequence is 2n+1 while being written and 2n+2 once complete (seqlock)
+	struct LatchSample {
+		std::atomic<uint64_t> sequence = 0;
+		std::atomic<double> cameraTime;
+		std::atomic<double> realTime;
+	};
+	// Single producer (sampleRun), single consumer (frame) handoff, frame drops samples older than the ring while stalled
+	std::array<LatchSample, 8> latchSamples;
+	std::atomic<uint64_t> latchWritten = 0;
+	uint64_t latchRead = 0;
+
+	std::thread sampler;
+	std::mutex samplerMutex;
+	std::condition_variable samplerSignal;
+	bool stopSampling = false;
+
+	bool latched = false; // clock is mapped by latch samples
+
+	// Lower envelope of delivery - timestamp within the current block
+	double blockStart = 0.0;
+	double blockMinOffset = INFINITY;
+	double blockCameraTime = 0.0;
+
+	double lastReport = 0.0;
+};
@@ -14,6 +14,8 @@
      limitations under the License.
  */
 #include <csignal>
+#include <numeric>
+#include <optional>
 #include "log.h"
 #include <opencv2/bgsegm.hpp>
 #include <yaml-cpp/yaml.h>
@@ -26,10 +28,16 @@
 #include "pattern.h"
 #include "cl_kernels.h"
 #include "blobs/hypothesis.h"
-#include "blobs/kdtree.h"
+#include "blobs/blobgrid.h"
+#include "blobs/patternmatcher.h"
+#include "blobs/trackedmatcher.h"
 #include "blobs/colorupdate.h"
+#include "latency.h"
 #include <opencv2/video/background_segm.hpp>
 
+// Blob search radius of tracked bots in standard deviations of the predicted blob position
+static const float TRACKING_SIGMAS = 3.0f;
+
 struct __attribute__ ((packed)) CLMatch {
 	float x, y;
 	RGB color;
@@ -40,126 +48,110 @@ struct __attribute__ ((packed)) CLMatch {
 	auto operator<=>(const CLMatch&) const = default;
 };
 
-void generateAngleSortedBotHypotheses(const Resources& r, std::list<std::unique_ptr<BotHypothesis>>& bots, std::vector<Match>& matches, KDTree& blobs) {
-	std::vector<Match*> botBlobs;
-	for(int i = 0; i < blobs.getSize(); i++) {
-		Match& blob = matches[i];
-
-		float bestBotScore = 0.0f;
-		std::unique_ptr<BotHypothesis> bestBot = nullptr;
+struct __attribute__ ((packed)) CLBotMatch {
+	cl_int blobs[5];
+	float score; // 0: no hypothesis, -1: neighbour or grid overflow, search on the host
+};
 
-		botBlobs.clear();
-		blobs.rangeSearch(botBlobs, blob.pos, r.perspective->field.max_robot_radius());
-		if(botBlobs.size() < 4)
-			continue;
+// Per-thread scratch buffers of the hypothesis generators
+struct HypothesisScratch {
+	PatternMatcher matcher;
+	TrackedMatcher trackedMatcher;
+	std::vector<Match*> blobs[5];
+	Eigen::Vector2f positions[5];
+};
 
-		std::sort(botBlobs.begin(), botBlobs.end(), [&](const Match* a, const Match* b) -> bool {
-			Eigen::Vector2f aDiff = a->pos - blob.pos;
-			Eigen::Vector2f bDiff = b->pos - blob.pos;
-			return atan2_fast(aDiff.y(), aDiff.x()) < atan2_fast(bDiff.y(), bDiff.x());
-		});
+// Results are stored per blob/tracked object and merged in that order, independent of the thread amount
+static void mergeHypotheses(std::vector<BotHypothesis>& bots, std::vector<std::optional<BotHypothesis>>& results) {
+	for(const std::optional<BotHypothesis>& bot : results) {
+		if(bot.has_value())
+			bots.push_back(*bot);
+	}
+}
 
-		const int size = (int)botBlobs.size();
-		for(int a = 0; a < size; a++) {
-			for(int b = a+1; b < a+size-2; b++) {
-				for(int c = b+1; c < a+size-1; c++) {
-					for(int d = c+1; d < a+size; d++) {
-						std::unique_ptr<BotHypothesis> bot = std::make_unique<DetectionBotHypothesis>(r, &blob, botBlobs[a], botBlobs[b%size], botBlobs[c%size], botBlobs[d%size]);
-						if(bot->score > bestBotScore) {
-							bestBotScore = bot->score;
-							bestBot = std::move(bot);
-						}
-					}
-				}
-			}
-		}
+// Keeps the elements without removed flag in their order
+template<typename T>
+static void compact(std::vector<T>& values, const std::vector<bool>& removed) {
+	size_t kept = 0;
+	for(size_t i = 0; i < values.size(); i++) {
+		if(removed[i])
+			continue;
 
-		bots.push_back(std::move(bestBot));
+		if(kept != i)
+			values[kept] = std::move(values[i]);
+		kept++;
 	}
+	values.erase(values.begin() + (long)kept, values.end());
 }
 
-void generateRadiusSearchTrackedBotHypotheses(const Resources& r, std::list<std::unique_ptr<BotHypothesis>>& bots, std::vector<Match>& matches, KDTree& blobs, const double currentTimestamp) {
-	std::vector<Match*> botBlobs[5];
-	for (const auto& camTracked : r.socket->getTrackedObjects()) {
-		for (const auto& tracked : camTracked.second) {
-			if(tracked.id == -1)
-				continue;
-
-			auto timeDelta = (float)(currentTimestamp - tracked.timestamp);
-			Eigen::Vector2f reprojectedPosition = r.perspective->model.image2field(r.perspective->model.field2image({tracked.x, tracked.y, tracked.z}), r.gcSocket->maxBotHeight).head<2>();
-			Eigen::Vector3f trackedPosition = Eigen::Vector3f(reprojectedPosition.x(), reprojectedPosition.y(), tracked.w) + Eigen::Vector3f(tracked.vx, tracked.vy, tracked.vw) * timeDelta;
-			Eigen::Rotation2Df rotation(trackedPosition.z());
-
-			//prevent runtime escalation due to excessive timeDelta when FPS drop below 20 FPS or times are not synced
-			timeDelta = std::max(std::min(timeDelta, 0.05f), 0.0f);
-			//Double acceleration due to velocity determination from two frame difference
-			float blobSearchRadius = (float)r.maxBotAcceleration * timeDelta * timeDelta + (float)r.minTrackingRadius;
-
-			float bestBotScore = 0.0f;
-			std::unique_ptr<BotHypothesis> bestBot = nullptr;
-
-			for(int i = 0; i < 5; i++) {
-				botBlobs[i].clear();
-				botBlobs[i].push_back(nullptr);
-				blobs.rangeSearch(botBlobs[i], trackedPosition.head<2>() + rotation * patternPos[i], blobSearchRadius);
-			}
+// gpuMatches (optional) contains the pattern search results of matches2botHypotheses, only the color classification remains
+void generateAngleSortedBotHypotheses(const Resources& r, std::vector<BotHypothesis>& bots, std::vector<Match>& matches, const BlobGrid& blobs, std::vector<HypothesisScratch>& scratches, const CLBotMatch* gpuMatches) {
+	std::vector<std::optional<BotHypothesis>> results(blobs.getSize());
+	r.threadPool->parallelFor(blobs.getSize(), [&](const int i, const int thread) {
+		HypothesisScratch& scratch = scratches[thread];
+		Match& blob = matches[i];
 
-			for(Match* const& a : botBlobs[0]) {
-				for(Match* const& b : botBlobs[1]) {
-					if(b != nullptr && a == b)
-						continue;
-
-					for(Match* const& c : botBlobs[2]) {
-						if(c != nullptr && (a == c || b == c))
-							continue;
-
-						for(Match* const& d : botBlobs[3]) {
-							if(d != nullptr && (a == d || b == d || c == d))
-								continue;
-
-							for(Match* const& e : botBlobs[4]) {
-								if (e != nullptr && (a == e || b == e || c == e || d == e))
-									continue;
-
-								std::unique_ptr<BotHypothesis> bot = std::make_unique<TrackedBotHypothesis>(r, tracked, trackedPosition, a, b, c, d, e);
-								if(bot->score > bestBotScore) {
-									bestBotScore = bot->score;
-									bestBot = std::move(bot);
-								}
-							}
-						}
-					}
-				}
-			}
+		if(gpuMatches != nullptr && gpuMatches[i].score >= 0.0f) {
+			const CLBotMatch& match = gpuMatches[i];
+			if(match.score > 0.0f)
+				results[i].emplace(r, &blob, &matches[match.blobs[1]], &matches[match.blobs[2]], &matches[match.blobs[3]], &matches[match.blobs[4]]);
+			return;
+		}
 
-			if(bestBot == nullptr)
-				continue;
+		scratch.blobs[0].clear();
+		blobs.rangeSearch(scratch.blobs[0], blob.pos, r.perspective->field.max_robot_radius());
+		if(scratch.blobs[0].size() < 4)
+			return;
 
-			bots.push_back(std::move(bestBot));
+		results[i] = scratch.matcher.match(r, &blob, scratch.blobs[0]);
+	});
+	mergeHypotheses(bots, results);
+}
+
+void generateRadiusSearchTrackedBotHypotheses(const Resources& r, std::vector<BotHypothesis>& bots, std::vector<Match>& matches, const BlobGrid& blobs, const double currentTimestamp, std::vector<HypothesisScratch>& scratches) {
+	const std::shared_ptr<const TrackedObjects> trackedObjects = r.socket->getTrackedObjects();
+	const std::vector<TrackingState>& trackedBots = trackedObjects->bots;
+
+	std::vector<std::optional<BotHypothesis>> results(trackedBots.size());
+	r.threadPool->parallelFor((int)trackedBots.size(), [&](const int index, const int thread) {
+		HypothesisScratch& scratch = scratches[thread];
+		const TrackingState& tracked = trackedBots[index];
+
+		auto timeDelta = (float)(currentTimestamp - tracked.timestamp);
+		Eigen::Vector2f reprojectedPosition = r.perspective->model.reprojectHeight({tracked.x, tracked.y, tracked.z}, (float)r.gcSocket->maxBotHeight).head<2>();
+		Eigen::Vector3f trackedPosition = Eigen::Vector3f(reprojectedPosition.x(), reprojectedPosition.y(), tracked.w) + Eigen::Vector3f(tracked.vx, tracked.vy, tracked.vw) * timeDelta;
+		Eigen::Rotation2Df rotation(trackedPosition.z());
+
+		//prevent runtime escalation due to excessive timeDelta when FPS drop below 20 FPS or times are not synced
+		timeDelta = std::max(std::min(timeDelta, 0.05f), 0.0f);
+		//Search radius of each blob from the predicted Kalman filter covariance, the orientation uncertainty moves side blobs
+		const float acceleration = r.socket->getMaxBotAcceleration();
+		const float angularAcceleration = r.socket->getMaxBotAngularAcceleration();
+		const float positionVariance = KalmanAxis::predictedVariance(tracked.positionCovariance, timeDelta, acceleration * acceleration);
+		const float orientationVariance = KalmanAxis::predictedVariance(tracked.orientationCovariance, timeDelta, angularAcceleration * angularAcceleration);
+		float blobSearchRadii[5];
+
+		for(int i = 0; i < 5; i++) {
+			scratch.blobs[i].clear();
+			scratch.positions[i] = trackedPosition.head<2>() + rotation * patternPos[i];
+			const float sigma = sqrtf(positionVariance + orientationVariance * patternPos[i].squaredNorm());
+			blobSearchRadii[i] = std::clamp(TRACKING_SIGMAS * sigma, (float)r.minTrackingRadius, std::max((float)r.minTrackingRadius, r.perspective->field.max_robot_radius()));
 		}
-	}
+		blobs.rangeSearch(scratch.blobs, scratch.positions, 5, blobSearchRadii);
+
+		results[index] = scratch.trackedMatcher.match(r, tracked, trackedPosition, scratch.blobs, scratch.positions);
+	});
+	mergeHypotheses(bots, results);
 }
 
 template<typename T>
-void filterHypothesesScore(std::list<std::unique_ptr<T>>& bots, float threshold) {
-	for(auto it = bots.cbegin(); it != bots.cend(); ) {
-		if((*it)->score <= threshold) {
-			it = bots.erase(it);
-		} else {
-			it++;
-		}
-	}
+void filterHypothesesScore(std::vector<T>& bots, float threshold) {
+	std::erase_if(bots, [&](const T& bot) { return bot.score <= threshold; });
 }
 
 template<typename T>
-void filterStddevScore(std::list<std::unique_ptr<T>>& bots, float threshold) {
-	for(auto it = bots.cbegin(); it != bots.cend(); ) {
-		if((*it)->blob->score <= threshold) {
-			it = bots.erase(it);
-		} else {
-			it++;
-		}
-	}
+void filterStddevScore(std::vector<T>& bots, float threshold) {
+	std::erase_if(bots, [&](const T& bot) { return bot.blob->score <= threshold; });
 }
 
 static inline bool closerThanCamEdgeDistance(const Resources& r, const Eigen::Vector2f& pos, const Eigen::Vector2f& border) {
@@ -174,69 +166,88 @@ static inline bool closerThanCamEdgeDistance(const Resources& r, const Eigen::Ve
 	return borderInsideField && (borderPos - pos).squaredNorm() < r.minCamEdgeDistance*r.minCamEdgeDistance;
 }
 
-void filterBallsAtCamEdge(const Resources& r, std::list<std::unique_ptr<BallHypothesis>>& balls) {
-	for(auto it = balls.cbegin(); it != balls.cend(); ) {
-		const Eigen::Vector2f& pos = (*it)->pos;
+void filterBallsAtCamEdge(const Resources& r, std::vector<BallHypothesis>& balls) {
+	std::erase_if(balls, [&](const BallHypothesis& ball) {
+		const Eigen::Vector2f& pos = ball.pos;
 		const Eigen::Vector2f imgPos = r.perspective->model.field2image({pos.x(), pos.y(), (float)r.gcSocket->maxBotHeight});
 
-		if(
+		return
 				closerThanCamEdgeDistance(r, pos, Eigen::Vector2f(0.0f, imgPos.y())) ||
 				closerThanCamEdgeDistance(r, pos, Eigen::Vector2f(r.perspective->model.size.x()-1, imgPos.y())) ||
 				closerThanCamEdgeDistance(r, pos, Eigen::Vector2f(imgPos.x(), 0.0f)) ||
-				closerThanCamEdgeDistance(r, pos, Eigen::Vector2f(imgPos.x(), r.perspective->model.size.y()-1))
-		) {
-			it = balls.erase(it);
-		} else {
-			it++;
-		}
-	}
+				closerThanCamEdgeDistance(r, pos, Eigen::Vector2f(imgPos.x(), r.perspective->model.size.y()-1));
+	});
 }
 
-void filterClippingBotBotHypotheses(const Resources& r, std::list<std::unique_ptr<BotHypothesis>>& bots) {
-	for (auto it1 = bots.cbegin(); it1 != bots.cend(); ) {
-		const auto& bot1 = *it1;
-		bool remove = false;
-		for (auto it2 = bots.cbegin(); it2 != bots.cend(); it2++) {
-			const auto& bot2 = *it1;
-			if (bot2->score > bot1->score && bot1->isClipping(r, *bot2)) {
-				remove = true;
-				break;
-			}
-		}
+// Positions sorted by x, neighbours within a radius are found by a binary search and a sweep over the x range
+class PositionSweep {
+public:
+	explicit PositionSweep(std::vector<Eigen::Vector2f> points): positions(std::move(points)), order(positions.size()) {
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](const int a, const int b) { return positions[a].x() < positions[b].x(); });
+		xs.reserve(order.size());
+		for(const int i : order)
+			xs.push_back(positions[i].x());
+	}
 
-		if(remove) {
-			it1 = bots.erase(it1);
-			continue;
+	template<typename F>
+	void forEachNeighbour(const Eigen::Vector2f& point, const float radius, F&& f) const {
+		for(auto it = std::lower_bound(xs.cbegin(), xs.cend(), point.x() - radius); it != xs.cend() && *it <= point.x() + radius; it++) {
+			const int i = order[it - xs.cbegin()];
+			if(std::abs(positions[i].y() - point.y()) <= radius)
+				f(i);
 		}
+	}
 
-		for (auto it2 = bots.cbegin(); it2 != bots.cend(); ) {
-			const auto& bot2 = *it2;
-			if (bot2->score <= bot1->score && bot1->isClipping(r, *bot2) && it1 != it2) {
-				it2 = bots.erase(it2);
-			} else {
-				it2++;
-			}
-		}
+private:
+	std::vector<Eigen::Vector2f> positions;
+	std::vector<int> order;
+	std::vector<float> xs;
+};
+
+static PositionSweep botSweep(const std::vector<BotHypothesis>& bots) {
+	std::vector<Eigen::Vector2f> positions;
+	positions.reserve(bots.size());
+	for(const BotHypothesis& bot : bots)
+		positions.push_back(bot.pos);
 
-		it1++;
+	return PositionSweep(std::move(positions));
+}
+
+// Greedy in vector order: every remaining bot removes all clipping bots with a lower or equal score.
+// isClipping is always false beyond 2*MIN_ROBOT_RADIUS, so only those neighbours are tested.
+void filterClippingBotBotHypotheses(const Resources& r, std::vector<BotHypothesis>& bots) {
+	const PositionSweep sweep = botSweep(bots);
+	std::vector<bool> removed(bots.size(), false);
+	for(int i = 0; i < (int)bots.size(); i++) {
+		if(removed[i])
+			continue;
+
+		const BotHypothesis& bot1 = bots[i];
+		sweep.forEachNeighbour(bot1.pos, 2*MIN_ROBOT_RADIUS, [&](const int j) {
+			const BotHypothesis& bot2 = bots[j];
+			if(j != i && !removed[j] && bot2.score <= bot1.score && bot1.isClipping(r, bot2))
+				removed[j] = true;
+		});
 	}
+
+	compact(bots, removed);
 }
 
-void generateNonclippingBallHypotheses(const Resources& r, const std::list<std::unique_ptr<BotHypothesis>>& bots, std::vector<Match>& matches, std::list<std::unique_ptr<BallHypothesis>>& balls) {
+// Matches next to a bot are rejected by position before the color scoring of the ball hypothesis
+void generateNonclippingBallHypotheses(const Resources& r, const std::vector<BotHypothesis>& bots, std::vector<Match>& matches, std::vector<BallHypothesis>& balls) {
+	const PositionSweep sweep = botSweep(bots);
+	const float clippingDistance = BotHypothesis::ballClippingDistance(r);
 	for (const auto& match : matches) {
-		std::unique_ptr<BallHypothesis> ball = std::make_unique<BallHypothesis>(r, &match);
 		bool nextToBot = false;
-		for (const auto& bot : bots) {
-			if (bot->isClipping(r, *ball)) {
-				nextToBot = true;
-				break;
-			}
-		}
+		sweep.forEachNeighbour(match.pos, clippingDistance, [&](const int i) {
+			nextToBot = nextToBot || bots[i].isClipping(r, match.pos);
+		});
 
 		if(nextToBot)
 			continue;
 
-		balls.push_back(std::move(ball));
+		balls.emplace_back(r, &match);
 	}
 }
 
@@ -250,12 +261,20 @@ void sig_stop(int sig_num) {
 
 int main(int argc, char* argv[]) {
 	Resources r(argc > 1 ? argv[1] : "config.yml");
-	cl::Kernel blobList = r.openCl->compile(kernel_blobList_cl);
 
 	uint32_t frameId = 0;
 	double lastDebugSaveTime = 0.0;
 	CLArray matchArray(sizeof(CLMatch) * r.maxBlobs);
 	CLArray counter(sizeof(cl_int)*3);
+	CLArray botMatchArray(sizeof(CLBotMatch) * r.maxBlobs);
+	std::vector<HypothesisScratch> scratches(r.threadPool->size());
+	// Reused across frames to keep their capacity
+	std::vector<BotHypothesis> botHypotheses;
+	std::vector<BallHypothesis> ballHypotheses;
+	// Detection output, reset each frame. The initial block covers a full field of detected objects.
+	std::vector<char> outputArenaBlock(1 << 16);
+	google::protobuf::Arena outputArena(outputArenaBlock.data(), outputArenaBlock.size());
+	LatencyTelemetry latency(*r.camera);
 
 	signal(SIGTERM, sig_stop);
 	signal(SIGINT, sig_stop);
@@ -286,7 +305,9 @@ int main(int argc, char* argv[]) {
 				counterMap[1] = 0;
 				counterMap[2] = 0;
 			}
-			r.openCl->await(blobList, cl::EnqueueArgs(cl::NDRange(r.perspective->reprojectedFieldSize[0], r.perspective->reprojectedFieldSize[1])), flat->image, blobCenter->image, matchArray.buffer, counter.buffer, (float)r.minCircularity, (float)0.0f, (int)floorf(r.perspective->minBlobRadius / r.perspective->fieldScale), r.maxBlobs);
+			r.openCl->await(r.blobList, cl::EnqueueArgs(cl::NDRange(r.perspective->reprojectedFieldSize[0], r.perspective->reprojectedFieldSize[1])), flat->image, blobCenter->image, matchArray.buffer, counter.buffer, r.blobDisc->buffer, r.processingMask->buffer, (float)r.minCircularity, (float)0.0f, r.maxBlobs);
+			if(r.gpuHypotheses)
+				r.matches2botHypotheses(matchArray, counter, botMatchArray);
 
 			if(r.debugImages && frameId == 1) {
 				flat->save(".flat." + std::to_string(frameId) + ".png");
@@ -294,7 +315,7 @@ int main(int argc, char* argv[]) {
 				blobCenter->save(".blob." + std::to_string(frameId) + ".png");
 			}
 
-			std::vector<Match> matches; //Same lifetime as KDTree required
+			std::vector<Match> matches; //Same lifetime as BlobGrid required
 			{
 				CLMap<int> counterMap = counter.read<int>();
 				CLMap<CLMatch> matchMap = matchArray.read<CLMatch>();
@@ -316,34 +337,40 @@ int main(int argc, char* argv[]) {
 					WARN("max blob amount reached: " << counterMap[0] << "/" << r.maxBlobs);
 			}
 
-			std::list<std::unique_ptr<BotHypothesis>> botHypotheses;
-			std::list<std::unique_ptr<BallHypothesis>> ballHypotheses;
+			botHypotheses.clear();
+			ballHypotheses.clear();
 
+			classifyColors(r, matches);
 			if(!matches.empty()) {
-				KDTree blobs = KDTree(&matches[0]);
-				for(unsigned int i = 1; i < matches.size(); i++)
-					blobs.insert(&matches[i]);
-
-				generateRadiusSearchTrackedBotHypotheses(r, botHypotheses, matches, blobs, startTime);
-				generateAngleSortedBotHypotheses(r, botHypotheses, matches, blobs);
+				BlobGrid blobs(matches, r.perspective->field.max_robot_radius());
+
+				generateRadiusSearchTrackedBotHypotheses(r, botHypotheses, matches, blobs, startTime, scratches);
+				if(r.gpuHypotheses) {
+					CLMap<CLBotMatch> botMatchMap = botMatchArray.read<CLBotMatch>();
+					generateAngleSortedBotHypotheses(r, botHypotheses, matches, blobs, scratches, *botMatchMap);
+				} else {
+					generateAngleSortedBotHypotheses(r, botHypotheses, matches, blobs, scratches, nullptr);
+				}
 				filterHypothesesScore(botHypotheses, r.minConfidence);
 				filterClippingBotBotHypotheses(r, botHypotheses);
 				generateNonclippingBallHypotheses(r, botHypotheses, matches, ballHypotheses);
 			}
 
 			updateColors(r, botHypotheses, ballHypotheses);
+			classifyColors(r, matches);
 			for (auto& bot : botHypotheses)
-				bot->recalcPostColorCalib(r);
+				bot.recalcPostColorCalib(r);
 			for (auto& ball : ballHypotheses)
-				ball->recalcPostColorCalib(r);
+				ball.recalcPostColorCalib(r);
 
 			filterHypothesesScore(ballHypotheses, r.minConfidence);
 			filterBallsAtCamEdge(r, ballHypotheses);
 			filterStddevScore(ballHypotheses, (float)r.minScore);
 
-			SSL_WrapperPacket wrapper;
-			wrapper.set_source(SSL_SOURCE_VISION_PROCESSOR);
-			SSL_DetectionFrame* detection = wrapper.mutable_detection();
+			outputArena.Reset();
+			auto* wrapper = google::protobuf::Arena::Create<SSL_WrapperPacket>(&outputArena);
+			wrapper->set_source(SSL_SOURCE_VISION_PROCESSOR);
+			SSL_DetectionFrame* detection = wrapper->mutable_detection();
 			detection->set_frame_number(frameId);
 			detection->set_t_capture(startTime);
 			if(img->timestamp != 0)
@@ -351,28 +378,50 @@ int main(int argc, char* argv[]) {
 			detection->set_camera_id(r.camId);
 
 			for (const auto& bot : botHypotheses)
-				bot->addToDetectionFrame(r, detection);
+				bot.addToDetectionFrame(r, detection);
 			for (const auto& ball : ballHypotheses)
-				ball->addToDetectionFrame(r, detection);
+				ball.addToDetectionFrame(r, detection);
 
-			for (const float& offset : r.socket->getReceivedOffsets())
+			for (const float& offset : *r.socket->getReceivedOffsets())
 				detection->add_t_offsets(offset);
 
 			double processingTime = getRealTime() - realStartTime;
 
+			long combinationsTried = 0;
+			long combinationsScored = 0;
+			long trackedTried = 0;
+			long trackedScored = 0;
+			long trackedCapped = 0;
+			for(HypothesisScratch& scratch : scratches) {
+				combinationsTried += scratch.matcher.tried;
+				combinationsScored += scratch.matcher.scored;
+				scratch.matcher.resetStats();
+				trackedTried += scratch.trackedMatcher.tried;
+				trackedScored += scratch.trackedMatcher.scored;
+				trackedCapped += scratch.trackedMatcher.capped;
+				scratch.trackedMatcher.resetStats();
+			}
+
+			const double sendStartTime = getRealTime();
 #if BENCHMARK
 			detection->set_t_sent(startTime + processingTime);
-			LOG("time " << processingTime * 1000.0 << " ms " << matches.size() << " blobs " << detection->balls().size() << " balls " << (detection->robots_yellow_size() + detection->robots_blue_size()) << " bots");
-			r.openCl->printRuntimes();
 #else
 			detection->set_t_sent(r.camera->getTime());
 #endif
-			r.socket->send(wrapper);
+			if(r.shmRing)
+				r.shmRing->write(*wrapper);
+			r.socket->send(*wrapper);
+			const double sendTime = getRealTime() - sendStartTime; // t_sent stamping to sendto return, including the shared memory output
+			latency.frame(*img, realStartTime, realStartTime + processingTime, sendStartTime + sendTime);
+#if BENCHMARK
+			LOG("time " << processingTime * 1000.0 << " ms send " << sendTime * 1000.0 << " ms " << matches.size() << " blobs " << detection->balls().size() << " balls " << (detection->robots_yellow_size() + detection->robots_blue_size()) << " bots " << combinationsScored << "/" << combinationsTried << " pattern combinations scored " << trackedScored << "/" << trackedTried << " tracked combinations scored (" << trackedCapped << " capped)");
+			r.openCl->printRuntimes();
+#endif
 			r.socket->updateTime();
 			r.openCl->clearEvents();
 
 			if(processingTime > r.camera->expectedFrametime())
-				LOG("frame time overrun: " << processingTime * 1000.0 << " ms " << matches.size() << " blobs " << detection->balls().size() << " balls " << (detection->robots_yellow_size() + detection->robots_blue_size()) << " bots");
+				LOG("frame time overrun: " << processingTime * 1000.0 << " ms send " << sendTime * 1000.0 << " ms " << matches.size() << " blobs " << detection->balls().size() << " balls " << (detection->robots_yellow_size() + detection->robots_blue_size()) << " bots " << combinationsScored << "/" << combinationsTried << " pattern combinations scored");
 
 			if(r.rawFeed) {
 				r.streamQuad(channels);
@@ -422,6 +471,9 @@ int main(int argc, char* argv[]) {
 		}
 	}
 
+	latency.report();
+	if(r.rtpStreamer->encodeCpuTime() > 0.0)
+		LOG("Stream encoding used " << r.rtpStreamer->encodeCpuTime() << " s CPU in total");
 	LOG("Stopping vision_processor");
 	return 0;
 }
@@ -0,0 +1,97 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include <random>
+#include <vector>
+#include "fastmath.h"
+#include "driver/cameradriver.h"
+
+static const int SIZE = 1 << 16;
+static const int REPETITIONS = 200;
+
+// Documented error bounds of fastmath.h
+static const double ATAN2_BOUND = 1.0e-5;
+static const double SINCOS_BOUND = 1.2e-7;
+static const double WRAP_BOUND = 2.4e-7;
+
+static volatile float sink;
+
+template<typename F>
+static double nsPerElement(F&& f) {
+	const double startTime = getRealTime();
+	for(int r = 0; r < REPETITIONS; r++)
+		f();
+	return (getRealTime() - startTime) / REPETITIONS / SIZE * 1e9;
+}
+
+static void report(const char* name, const double error, const double bound) {
+	std::cout << "[Math benchmark] " << name << " max error " << error << (error <= bound ? " within " : " EXCEEDS ") << bound << std::endl;
+}
+
+int main() {
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> coordDist(-5000.0f, 5000.0f);
+	std::uniform_real_distribution<float> angleDist(-8192.0f, 8192.0f);
+	std::uniform_real_distribution<float> wrapDist(-256.0f, 256.0f);
+
+	std::vector<float> y(SIZE), x(SIZE), angle(SIZE), wrap(SIZE);
+	for(int i = 0; i < SIZE; i++) {
+		y[i] = coordDist(rng);
+		x[i] = coordDist(rng);
+		angle[i] = angleDist(rng);
+		wrap[i] = wrapDist(rng);
+	}
+	// Axes, zero and small magnitudes
+	for(int i = 0; i < 64; i++) {
+		const float v = (float)(i - 32) * 0.25f;
+		y[i] = i % 2 ? v : 0.0f;
+		x[i] = i % 2 ? 0.0f : v;
+		angle[i] = v;
+		wrap[i] = (float)(i - 32) * (float)M_PI_2;
+	}
+
+	std::vector<float> out(SIZE), sin(SIZE), cos(SIZE);
+	atan2_fast(y.data(), x.data(), out.data(), SIZE);
+	double atan2Error = 0.0;
+	for(int i = 0; i < SIZE; i++)
+		atan2Error = std::max(atan2Error, std::abs(std::remainder(std::atan2((double)y[i], (double)x[i]) - out[i], 2*M_PI)));
+
+	sincos_fast(angle.data(), sin.data(), cos.data(), SIZE);
+	double sincosError = 0.0;
+	for(int i = 0; i < SIZE; i++)
+		sincosError = std::max({sincosError, std::abs(std::sin((double)angle[i]) - sin[i]), std::abs(std::cos((double)angle[i]) - cos[i])});
+
+	wrapAngle(wrap.data(), out.data(), SIZE);
+	double wrapError = 0.0;
+	for(int i = 0; i < SIZE; i++)
+		wrapError = std::max(wrapError, std::abs(std::remainder(std::remainder((double)wrap[i], 2*M_PI) - out[i], 2*M_PI)));
+
+	report("atan2_fast", atan2Error, ATAN2_BOUND);
+	report("sincos_fast", sincosError, SINCOS_BOUND);
+	report("wrapAngle", wrapError, WRAP_BOUND);
+
+	const double libAtan2 = nsPerElement([&]() { for(int i = 0; i < SIZE; i++) out[i] = atan2f(y[i], x[i]); sink = out[SIZE-1]; });
+	const double fastAtan2 = nsPerElement([&]() { atan2_fast(y.data(), x.data(), out.data(), SIZE); sink = out[SIZE-1]; });
+	const double libSincos = nsPerElement([&]() { for(int i = 0; i < SIZE; i++) { sin[i] = sinf(angle[i]); cos[i] = cosf(angle[i]); } sink = sin[SIZE-1] + cos[SIZE-1]; });
+	const double fastSincos = nsPerElement([&]() { sincos_fast(angle.data(), sin.data(), cos.data(), SIZE); sink = sin[SIZE-1] + cos[SIZE-1]; });
+	const double libWrap = nsPerElement([&]() { for(int i = 0; i < SIZE; i++) out[i] = remainderf(wrap[i], 2.0f * (float)M_PI); sink = out[SIZE-1]; });
+	const double fastWrap = nsPerElement([&]() { wrapAngle(wrap.data(), out.data(), SIZE); sink = out[SIZE-1]; });
+
+	std::cout << "[Math benchmark] atan2  libm " << libAtan2 << " ns fast " << fastAtan2 << " ns per element" << std::endl;
+	std::cout << "[Math benchmark] sincos libm " << libSincos << " ns fast " << fastSincos << " ns per element" << std::endl;
+	std::cout << "[Math benchmark] wrap   libm " << libWrap << " ns fast " << fastWrap << " ns per element" << std::endl;
+
+	return atan2Error <= ATAN2_BOUND && sincosError <= SINCOS_BOUND && wrapError <= WRAP_BOUND ? 0 : 1;
+}
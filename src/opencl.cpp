@@ -28,6 +28,8 @@ const PixelFormat PixelFormat::NV12 = PixelFormat(1, 2, true, CV_8UC1, {CL_R, CL
 
 const PixelFormat PixelFormat::RGGB8 = PixelFormat(2, 2, true, CV_8UC1, {CL_R, CL_UNSIGNED_INT8}, "-DRGGB");
 const PixelFormat PixelFormat::GRBG8 = PixelFormat(2, 2, true, CV_8UC1, {CL_R, CL_UNSIGNED_INT8}, "-DGRBG");
+const PixelFormat PixelFormat::RGGB10P = PixelFormat(2, 2, 10, true, CV_8UC1, {CL_R, CL_UNSIGNED_INT8}, "-DRGGB -DPACKED10"); //Do not use as OpenCL image format or with OpenCV, only as raw2quad input
+const PixelFormat PixelFormat::RGGB12P = PixelFormat(2, 2, 12, true, CV_8UC1, {CL_R, CL_UNSIGNED_INT8}, "-DRGGB -DPACKED12"); //Do not use as OpenCL image format or with OpenCV, only as raw2quad input
 const PixelFormat PixelFormat::BGR8 = PixelFormat(3, 1, true, CV_8UC3, {CL_RGB, CL_UNSIGNED_INT8}, "-DBGR"); //Do not use as OpenCL image format, CL_RGB seldomly supported by hardware
 
 
@@ -65,6 +67,10 @@ bool OpenCL::searchDevice(const std::vector<cl::Platform>& platforms, cl_device_
 }
 
 cl::Kernel OpenCL::compile(const char *code, const std::string &options) {
+	auto cached = programCache.find({code, options});
+	if(cached != programCache.end())
+		return cached->second;
+
 	cl::Program::Sources sources;
 	sources.emplace_back(code);
 
@@ -81,6 +87,8 @@ cl::Kernel OpenCL::compile(const char *code, const std::string &options) {
 	if(kernels.empty()) {
 		FATAL("Kernel missing: " << code);
 	}
+
+	programCache[{code, options}] = kernels[0];
 	return kernels[0];
 }
 
@@ -100,6 +108,13 @@ void OpenCL::printRuntimes() {
 	std::cout << std::endl;
 }
 
+double OpenCL::sumRuntimes() {
+	double sum = 0.0;
+	for(const cl::Event& event : events)
+		sum += (double)(event.getProfilingInfo<CL_PROFILING_COMMAND_END>() - event.getProfilingInfo<CL_PROFILING_COMMAND_START>()) * 1e-6;
+	return sum;
+}
+
 void OpenCL::clearEvents() {
 	events.clear();
 }
@@ -38,20 +38,25 @@ public:
 	// Raw Bayer formats
 	static const PixelFormat RGGB8;
 	static const PixelFormat GRBG8;
+	// GenICam LSB packed Bayer formats (BayerRG10p, BayerRG12p), unpacked on the GPU by raw2quad
+	static const PixelFormat RGGB10P;
+	static const PixelFormat RGGB12P;
 
 	static const PixelFormat BGR8;
 
-	[[nodiscard]] int pixelSize() const { return stride*rowStride; }
+	[[nodiscard]] int pixelSize() const { return stride*rowStride*sampleBits/8; }
 
 	const int stride;
 	const int rowStride;
+	const int sampleBits;
 	const bool color;
 	const int cvType;
 	const cl::ImageFormat clFormat;
 
 	const char* kernelOptions;
 private:
-	PixelFormat(int stride, int rowStride, bool color, int cvType, const cl::ImageFormat& clFormat, const char* kernelOptions): stride(stride), rowStride(rowStride), color(color), cvType(cvType), clFormat(clFormat), kernelOptions(kernelOptions) {}
+	PixelFormat(int stride, int rowStride, int sampleBits, bool color, int cvType, const cl::ImageFormat& clFormat, const char* kernelOptions): stride(stride), rowStride(rowStride), sampleBits(sampleBits), color(color), cvType(cvType), clFormat(clFormat), kernelOptions(kernelOptions) {}
+	PixelFormat(int stride, int rowStride, bool color, int cvType, const cl::ImageFormat& clFormat, const char* kernelOptions): PixelFormat(stride, rowStride, 8, color, cvType, clFormat, kernelOptions) {}
 	PixelFormat(int stride, int rowStride, bool color, int cvType, const cl::ImageFormat& clFormat): PixelFormat(stride, rowStride, color, cvType, clFormat, "") {}
 };
 
@@ -71,6 +76,7 @@ class OpenCL {
 public:
 	OpenCL();
 
+	/** Compiled programs are cached by source and options, recompiling with previously used options is free. */
 	cl::Kernel compile(const char* code, const std::string& options = "");
 
 	template<typename... Ts>
@@ -93,6 +99,8 @@ public:
 	static void wait(const cl::Event& event);
 
 	void printRuntimes();
+	// Summed kernel runtimes since the last clearEvents() in ms
+	double sumRuntimes();
 	void clearEvents();
 
 	std::shared_ptr<CLImage> acquire(const PixelFormat* format, int width, int height, const std::string& name);
@@ -106,6 +114,8 @@ private:
 	cl::Context context;
 	cl::CommandQueue queue;
 
+	std::map<std::pair<const char*, std::string>, cl::Kernel> programCache;
+
 	std::map<const PixelFormat*, std::vector<std::shared_ptr<CLImage>>> pool;
 	std::vector<std::shared_ptr<RawImage>> nv12pool;
 
@@ -184,6 +194,8 @@ public:
 	const int height;
 	// timestamp of 0 indicates unavailability
 	double timestamp = 0;
+	// getRealTime() when the driver handed out the image, 0 indicates unavailability
+	double deliveryTime = 0;
 	const std::string name;
 };
 
@@ -0,0 +1,341 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include <chrono>
+#include <random>
+#include <thread>
+#include <unistd.h>
+#include <yaml-cpp/yaml.h>
+#include "latency.h"
+#include "log.h"
+#include "udpsocket.h"
+#include "proto/ssl_vision_wrapper.pb.h"
+#include "proto/ssl_gc_referee_message.pb.h"
+
+/*
+ * Stress test of the receiver side (VisionSocket, GCSocket) with fake peer cameras and a fake game controller on
+ * loopback multicast (TTL 0, packets do not leave the host). A simulated processing loop measures the frame time
+ * impact of the receiver threads, first without and then with the load.
+ *
+ * receiver_benchmark [-c cameras] [-f fps] [-b bots per team] [-B balls] [-o max clock offset ms]
+ *                    [-g geometry change interval s] [-r referee rate Hz] [-t phase duration s] [config.yml]
+ */
+
+// Every n-th packet of a peer includes the geometry, like the geometry publishing of ssl-vision
+static const int GEOMETRY_FRAMES = 3;
+// Floats touched by the simulated processing of a frame (4 MiB, exceeds L2 like the image processing)
+static const int WORKLOAD_SIZE = 1 << 20;
+
+struct LoadConfig {
+	int cameras = 8;
+	double fps = 100.0;
+	int bots = 11;
+	int balls = 1;
+	double maxOffset = 0.005;
+	double geometryChurn = 0.0; // 0: geometry never changes
+	double refereeRate = 10.0;
+	double seconds = 10.0;
+
+	std::string visionIp = "224.5.23.2";
+	int visionPort = 10006;
+	std::string gcIp = "224.5.23.1";
+	int gcPort = 10003;
+};
+
+struct PeerStats {
+	std::atomic<uint64_t> sent = 0;
+	std::atomic<uint64_t> late = 0; // frames sent more than one period late
+};
+
+static volatile float sink;
+
+// Clock of the fake peers, independent of realTimeOffset which is adjusted by the receiver under test
+static double systemTime() {
+	return (double)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() / 1e6;
+}
+
+static int senderSocket(const std::string& ip, const int port, struct sockaddr_in& addr) {
+	const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+	if(fd < 0)
+		FATAL("Failed to open UDP socket");
+
+	const int ttl = 0;
+	if(setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0)
+		FATAL("Setting TTL failed");
+
+	addr = {};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(port);
+	if(!inet_aton(ip.c_str(), &addr.sin_addr))
+		FATAL("Invalid UDP target address " << ip);
+
+	return fd;
+}
+
+static void sendMessage(const int fd, const struct sockaddr_in& addr, const google::protobuf::Message& msg, std::string& buffer, PeerStats& stats) {
+	msg.SerializeToString(&buffer);
+	if(sendto(fd, buffer.data(), buffer.size(), 0, (const sockaddr*)&addr, sizeof(addr)) < 0)
+		WARN("UDP Frame send failed: " << strerror(errno));
+	else
+		stats.sent++;
+}
+
+/** Sleeps until next and advances it by period, counts frames missing their slot. */
+static void pace(std::chrono::steady_clock::time_point& next, const std::chrono::duration<double> period, PeerStats& stats) {
+	std::this_thread::sleep_until(next);
+	const auto now = std::chrono::steady_clock::now();
+	if(now - next > period) {
+		stats.late++;
+		next = now;
+	}
+	next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+}
+
+static void fillGeometry(SSL_GeometryFieldSize& field, const int variant) {
+	field.set_field_length(12000 + 10 * variant);
+	field.set_field_width(9000);
+	field.set_goal_width(1800);
+	field.set_goal_depth(180);
+	field.set_boundary_width(300);
+	field.set_ball_radius(21.5f);
+}
+
+static void addBot(google::protobuf::RepeatedPtrField<SSL_DetectionRobot>& bots, const int id, const double phase, const double time, std::normal_distribution<float>& noise, std::mt19937& rng) {
+	SSL_DetectionRobot* bot = bots.Add();
+	const double angle = 0.5 * time + phase;
+	bot->set_confidence(0.9f);
+	bot->set_robot_id(id);
+	bot->set_x((float)(4000.0 * cos(angle)) + noise(rng));
+	bot->set_y((float)(3000.0 * sin(angle)) + noise(rng));
+	bot->set_orientation((float)remainder(angle + M_PI_2, 2 * M_PI));
+	bot->set_pixel_x(0.0f);
+	bot->set_pixel_y(0.0f);
+	bot->set_height(150.0f);
+}
+
+static void peerCamera(const LoadConfig& c, const int camId, const double offset, const std::atomic<bool>& running, PeerStats& stats) {
+	struct sockaddr_in addr;
+	const int fd = senderSocket(c.visionIp, c.visionPort, addr);
+	std::mt19937 rng(camId);
+	std::normal_distribution<float> noise(0.0f, 5.0f);
+	std::string buffer;
+
+	SSL_WrapperPacket wrapper;
+	const std::chrono::duration<double> period(1.0 / c.fps);
+	// Spread the peers over the frame period like free running cameras
+	auto next = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period * camId / c.cameras);
+	for(uint32_t frame = 0; running; frame++) {
+		pace(next, period, stats);
+
+		const double time = systemTime() + offset;
+		SSL_DetectionFrame* detection = wrapper.mutable_detection();
+		detection->Clear();
+		detection->set_frame_number(frame);
+		detection->set_t_capture(time - 0.008);
+		detection->set_t_sent(time);
+		detection->set_camera_id(camId);
+		for(int i = 0; i < c.balls; i++) {
+			SSL_DetectionBall* ball = detection->add_balls();
+			ball->set_confidence(0.9f);
+			ball->set_x((float)(2000.0 * cos(time + i)) + noise(rng));
+			ball->set_y((float)(2000.0 * sin(time + i)) + noise(rng));
+			ball->set_pixel_x(0.0f);
+			ball->set_pixel_y(0.0f);
+		}
+		for(int i = 0; i < c.bots; i++) {
+			addBot(*detection->mutable_robots_yellow(), i, 2 * M_PI * i / c.bots, time, noise, rng);
+			addBot(*detection->mutable_robots_blue(), i, 2 * M_PI * (i + 0.5) / c.bots, time, noise, rng);
+		}
+
+		if(frame % GEOMETRY_FRAMES == 0)
+			fillGeometry(*wrapper.mutable_geometry()->mutable_field(), c.geometryChurn > 0.0 ? (int)(systemTime() / c.geometryChurn) % 2 : 0);
+		else
+			wrapper.clear_geometry();
+
+		sendMessage(fd, addr, wrapper, buffer, stats);
+	}
+
+	close(fd);
+}
+
+static void fillTeam(Referee_TeamInfo& team, const std::string& name) {
+	team.set_name(name);
+	team.set_score(0);
+	team.set_red_cards(0);
+	team.set_yellow_cards(0);
+	team.set_timeouts(4);
+	team.set_timeout_time(300000000);
+	team.set_goalkeeper(0);
+}
+
+static void gameController(const LoadConfig& c, const std::string& teamName, const std::atomic<bool>& running, PeerStats& stats) {
+	struct sockaddr_in addr;
+	const int fd = senderSocket(c.gcIp, c.gcPort, addr);
+	std::string buffer;
+
+	Referee referee;
+	referee.set_stage(Referee_Stage_NORMAL_FIRST_HALF);
+	referee.set_command(Referee_Command_STOP);
+	referee.set_command_counter(1);
+	referee.set_command_timestamp((uint64_t)(systemTime() * 1e6));
+	fillTeam(*referee.mutable_yellow(), teamName);
+	fillTeam(*referee.mutable_blue(), teamName);
+
+	const std::chrono::duration<double> period(1.0 / c.refereeRate);
+	auto next = std::chrono::steady_clock::now();
+	while(running) {
+		pace(next, period, stats);
+		referee.set_packet_timestamp((uint64_t)(systemTime() * 1e6));
+		sendMessage(fd, addr, referee, buffer, stats);
+	}
+
+	close(fd);
+}
+
+/** Simulated processing loop at the peer frame rate: snapshot accesses of main.cpp and a fixed workload. */
+static void process(const LoadConfig& c, VisionSocket& socket, LatencyWindow& frameTimes, size_t& trackedBots) {
+	std::vector<float> workload(WORKLOAD_SIZE, 1.0f);
+	const std::chrono::duration<double> period(1.0 / c.fps);
+	PeerStats stats;
+
+	const double end = getRealTime() + c.seconds;
+	auto next = std::chrono::steady_clock::now();
+	while(getRealTime() < end) {
+		pace(next, period, stats);
+		const double startTime = getRealTime();
+
+		socket.geometryCheck();
+		const std::shared_ptr<const TrackedObjects> tracked = socket.getTrackedObjects();
+		trackedBots = tracked->bots.size();
+		float sum = 0.0f;
+		for(const TrackingState& bot : tracked->bots)
+			sum += bot.x + bot.y;
+		for(const float offset : *socket.getReceivedOffsets())
+			sum += offset;
+		for(const float v : workload)
+			sum += v;
+		sink = sum;
+		socket.updateTime();
+
+		frameTimes.add(getRealTime() - startTime);
+	}
+}
+
+static void printFrameTimes(const char* phase, const LatencyWindow& frameTimes) {
+	double p[4];
+	frameTimes.percentiles(p);
+	std::cout << "[Receiver benchmark] " << phase << " frame time p50 " << p[0] << " ms p90 " << p[1] << " ms p99 " << p[2] << " ms max " << p[3] << " ms" << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	LoadConfig c;
+	int option;
+	while((option = getopt(argc, argv, "c:f:b:B:o:g:r:t:")) != -1) {
+		switch(option) {
+			case 'c': c.cameras = std::stoi(optarg); break;
+			case 'f': c.fps = std::stod(optarg); break;
+			case 'b': c.bots = std::min(std::stoi(optarg), 16); break;
+			case 'B': c.balls = std::stoi(optarg); break;
+			case 'o': c.maxOffset = std::stod(optarg) / 1000.0; break;
+			case 'g': c.geometryChurn = std::stod(optarg); break;
+			case 'r': c.refereeRate = std::stod(optarg); break;
+			case 't': c.seconds = std::stod(optarg); break;
+			default: FATAL("Usage: " << argv[0] << " [-c cameras] [-f fps] [-b bots per team] [-B balls] [-o max clock offset ms] [-g geometry change interval s] [-r referee rate Hz] [-t phase duration s] [config.yml]");
+		}
+	}
+
+	const std::string configPath = optind < argc ? argv[optind] : "config.yml";
+	YAML::Node config = access(configPath.c_str(), R_OK) == 0 ? YAML::LoadFile(configPath) : YAML::Node();
+	YAML::Node network = config["network"];
+	YAML::Node tracking = config["tracking"];
+	c.visionIp = network["vision_ip"].as<std::string>(c.visionIp);
+	c.visionPort = network["vision_port"].as<int>(c.visionPort);
+	c.gcIp = network["gc_ip"].as<std::string>(c.gcIp);
+	c.gcPort = network["gc_port"].as<int>(c.gcPort);
+
+	const std::string botHeightsPath = config["bot_heights_file"].as<std::string>("robot-heights.yml");
+	std::map<std::string, double> botHeights = {{"Benchmark", 150.0}};
+	if(access(botHeightsPath.c_str(), R_OK) == 0)
+		botHeights = YAML::LoadFile(botHeightsPath).as<std::map<std::string, double>>();
+
+	// The processor under test uses the camera id after the fake peers
+	GCSocket gcSocket(c.gcIp, c.gcPort, botHeights);
+	VisionSocket socket(c.visionIp, c.visionPort, c.cameras, (float)gcSocket.defaultBotHeight, 1000.0f * tracking["max_bot_acceleration"].as<float>(6.5f), tracking["max_bot_angular_acceleration"].as<float>(50.0f));
+
+	std::cout << "[Receiver benchmark] " << c.cameras << " cameras x " << c.fps << " fps, " << c.bots << "+" << c.bots << " bots " << c.balls << " balls, clock offsets up to " << c.maxOffset * 1000.0 << " ms, referee " << c.refereeRate << " Hz, geometry change interval " << c.geometryChurn << " s" << std::endl;
+
+	LatencyWindow idleFrameTimes("idle");
+	size_t trackedBots;
+	process(c, socket, idleFrameTimes, trackedBots);
+
+	std::atomic<bool> running = true;
+	std::vector<PeerStats> peerStats(c.cameras);
+	PeerStats gcStats;
+	std::vector<std::thread> peers;
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<double> offsetDist(-c.maxOffset, c.maxOffset);
+	for(int i = 0; i < c.cameras; i++)
+		peers.emplace_back(peerCamera, std::cref(c), i, offsetDist(rng), std::cref(running), std::ref(peerStats[i]));
+	peers.emplace_back(gameController, std::cref(c), botHeights.begin()->first, std::cref(running), std::ref(gcStats));
+
+	// Warm up (geometry reception, filter initialization) before measuring
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+
+	uint64_t sentStart = 0;
+	for(const PeerStats& stats : peerStats)
+		sentStart += stats.sent;
+	const uint64_t receivedStart = socket.receivedDatagrams();
+	const uint64_t droppedStart = socket.droppedDatagrams();
+	const uint64_t gcSentStart = gcStats.sent;
+	const uint64_t gcReceivedStart = gcSocket.receivedDatagrams();
+	const double cpuStart = socket.receiverCpuTime();
+	const double gcCpuStart = gcSocket.receiverCpuTime();
+	const double startTime = getRealTime();
+
+	LatencyWindow loadFrameTimes("load");
+	process(c, socket, loadFrameTimes, trackedBots);
+
+	// Stop the peers and wait for the datagrams in flight
+	running = false;
+	for(std::thread& peer : peers)
+		peer.join();
+	std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+	uint64_t sent = 0;
+	uint64_t late = 0;
+	for(const PeerStats& stats : peerStats) {
+		sent += stats.sent;
+		late += stats.late;
+	}
+	sent -= sentStart;
+	const uint64_t gcSent = gcStats.sent - gcSentStart;
+
+	const double duration = getRealTime() - startTime;
+	const double cpu = socket.receiverCpuTime() - cpuStart;
+	const double gcCpu = gcSocket.receiverCpuTime() - gcCpuStart;
+	const uint64_t received = socket.receivedDatagrams() - receivedStart;
+	const uint64_t dropped = socket.droppedDatagrams() - droppedStart;
+	const uint64_t gcReceived = gcSocket.receivedDatagrams() - gcReceivedStart;
+
+	std::cout << "[Receiver benchmark] vision receiver CPU " << 100.0 * cpu / duration << " % of a core, " << (received ? cpu / (double)received * 1e6 : 0.0) << " us per datagram" << std::endl;
+	std::cout << "[Receiver benchmark] gc receiver CPU " << 100.0 * gcCpu / duration << " % of a core" << std::endl;
+	std::cout << "[Receiver benchmark] vision datagrams sent " << sent << " received " << received << " dropped by kernel " << dropped << " lost " << (int64_t)(sent - received) << ", late peer frames " << late << std::endl;
+	std::cout << "[Receiver benchmark] gc datagrams sent " << gcSent << " received " << gcReceived << std::endl;
+	std::cout << "[Receiver benchmark] tracked bots " << trackedBots << ", clock offset " << realTimeOffset * 1000.0 << " ms" << std::endl;
+	printFrameTimes("idle", idleFrameTimes);
+	printFrameTimes("load", loadFrameTimes);
+
+	return received < sent ? 1 : 0;
+}
@@ -15,7 +15,9 @@
  */
 #include "rtpstreamer.h"
 
+#include <cmath>
 #include <cstdlib>
+#include <ctime>
 #include "log.h"
 
 extern "C" {
@@ -26,7 +28,16 @@ extern "C" {
 }
 
 
-RTPStreamer::RTPStreamer(bool active, std::string uri, int framerate): active(active), uri(std::move(uri)), framerate(framerate), frametime_us(1000000 / framerate) {
+// Interval of the encoding statistics log
+static const std::chrono::seconds REPORT_INTERVAL(10);
+
+static double threadCpuTime() {
+	struct timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
+RTPStreamer::RTPStreamer(bool active, std::string uri, int framerate, int bitrate, std::vector<std::string> codecs, int threads): active(active), uri(std::move(uri)), framerate(framerate), bitrate(bitrate), codecs(std::move(codecs)), threads(threads), frametime(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / framerate))) {
 	encoder = std::thread(&RTPStreamer::encoderRun, this);
 }
 
@@ -42,6 +53,19 @@ RTPStreamer::~RTPStreamer() {
 	freeResources();
 }
 
+bool RTPStreamer::frameDue() {
+	if(!active)
+		return false;
+
+	const auto now = std::chrono::steady_clock::now();
+	if(now < nextFrameTime)
+		return false;
+
+	// Keep the average framerate without bursts after slow frames
+	nextFrameTime = now - nextFrameTime > frametime ? now + frametime : nextFrameTime + frametime;
+	return true;
+}
+
 //Adopted from CC BY-SA 4.0 https://stackoverflow.com/a/61988145 Dmitrii Zabotlin
 void RTPStreamer::sendFrame(std::shared_ptr<RawImage> image) {
 	if(!active)
@@ -50,6 +74,7 @@ void RTPStreamer::sendFrame(std::shared_ptr<RawImage> image) {
 	std::unique_lock<std::mutex> lock(queueMutex);
 
 	queue = std::move(image);
+	queueTime = std::chrono::steady_clock::now();
 	queueSignal.notify_one();
 }
 
@@ -58,18 +83,19 @@ void RTPStreamer::allocResources() {
 	if(codecCtx != nullptr)
 		return;
 
-	const AVCodec* codec;
-	std::vector<const char*> codecNames {"h264_nvenc", "h264_qsv", "h264_vaapi", "libx264"};
-	for (const auto &codecName : codecNames) {
-		codec = avcodec_find_encoder_by_name(codecName);
+	const auto setupStart = std::chrono::steady_clock::now();
+	const AVCodec* codec = nullptr;
+	for (const auto &codecName : codecs) {
+		codec = avcodec_find_encoder_by_name(codecName.c_str());
 		if(codec == nullptr)
 			continue;
 
 		codecCtx = avcodec_alloc_context3(codec);
 
-		codecCtx->bit_rate = 3500000;
+		codecCtx->bit_rate = bitrate;
 		codecCtx->width = width;
 		codecCtx->height = height;
+		codecCtx->thread_count = threads;
 		codecCtx->time_base.num = 1;
 		codecCtx->time_base.den = framerate;
 		codecCtx->gop_size = framerate;
@@ -77,10 +103,10 @@ void RTPStreamer::allocResources() {
 		codecCtx->pix_fmt = AV_PIX_FMT_NV12;
 		codecCtx->codec_type = AVMEDIA_TYPE_VIDEO;
 
-		if(strcmp(codecName, "h264_qsv") == 0) {
+		if(codecName == "h264_qsv") {
 			av_opt_set(codecCtx->priv_data, "preset", "veryfast", 0);
 		}
-		if(strcmp(codecName, "libx264") == 0) {
+		if(codecName == "libx264") {
 			av_opt_set(codecCtx->priv_data, "preset", "ultrafast", 0);
 			av_opt_set(codecCtx->priv_data, "tune", "zerolatency", 0);
 		}
@@ -96,7 +122,7 @@ void RTPStreamer::allocResources() {
 		FATAL("Failed to find suitable encoder.");
 	}
 
-	LOG("Using codec: " << codec->long_name);
+	LOG("Using codec: " << codec->long_name << " " << bitrate / 1000 << " kbit/s " << framerate << " fps");
 
 	fmtCtx  = avformat_alloc_context();
 	auto* avFormat = (AVOutputFormat*)av_guess_format("rtp", nullptr, nullptr);
@@ -121,6 +147,8 @@ void RTPStreamer::allocResources() {
 	frame->linesize[1] = width;
 
 	pkt = av_packet_alloc();
+
+	LOG("Encoder setup for " << width << "x" << height << " took " << std::chrono::duration<double>(std::chrono::steady_clock::now() - setupStart).count() * 1000.0 << " ms");
 }
 
 void RTPStreamer::freeResources() {
@@ -149,6 +177,7 @@ void RTPStreamer::freeResources() {
 void RTPStreamer::encoderRun() {
 	while(!stopEncoding) {
 		std::shared_ptr<RawImage> image;
+		std::chrono::steady_clock::time_point time;
 		{
 			std::unique_lock<std::mutex> lock(queueMutex);
 			while(queue == nullptr && !stopEncoding)
@@ -160,22 +189,31 @@ void RTPStreamer::encoderRun() {
 			}
 
 			image = queue;
+			time = queueTime;
 			queue = nullptr;
 		}
 
-		if(image->width != width || image->height != height) {
-			freeResources();
+		// The encoder is set up once for the resolution of the first frame, Resources scales all streamed images to it
+		if(width == 0) {
 			width = image->width;
 			height = image->height;
+			startTime = time;
+			reportTime = time;
+		} else if(image->width != width || image->height != height) {
+			WARN("Dropping stream frame with resolution " << image->width << "x" << image->height << " instead of " << width << "x" << height);
+			continue;
 		}
 
 		allocResources();
 
-		auto startTime = std::chrono::high_resolution_clock::now();
+		// Presentation time from the submission time, frames are submitted at up to framerate (see frameDue)
+		const int64_t pts = std::max(lastPts + 1, (int64_t)std::llround(std::chrono::duration<double>(time - startTime).count() * framerate));
+		lastPts = pts;
 
+		const double cpuStart = threadCpuTime();
 		{
 			CLMap<uint8_t> data = image->read<uint8_t>();
-			frame->pts = currentFrameId++;
+			frame->pts = pts;
 			frame->data[0] = *data;
 			frame->data[1] = *data + width*height;
 			avcodec_send_frame(codecCtx, frame);
@@ -192,7 +230,16 @@ void RTPStreamer::encoderRun() {
 		} else {
 			WARN("Encoder error: " << status);
 		}
-
-		std::this_thread::sleep_for(std::chrono::microseconds(frametime_us) - (std::chrono::high_resolution_clock::now() - startTime));
+		encodeCpuSeconds.store(encodeCpuSeconds.load(std::memory_order_relaxed) + threadCpuTime() - cpuStart, std::memory_order_relaxed);
+
+		reportFrames++;
+		const double reportDuration = std::chrono::duration<double>(time - reportTime).count();
+		if(time - reportTime >= REPORT_INTERVAL) {
+			const double cpu = encodeCpuSeconds.load(std::memory_order_relaxed) - reportCpuSeconds;
+			LOG("Stream encoding " << reportFrames / reportDuration << " fps, " << cpu / reportFrames * 1000.0 << " ms CPU per frame (" << 100.0 * cpu / reportDuration << " % of a core)");
+			reportCpuSeconds += cpu;
+			reportFrames = 0;
+			reportTime = time;
+		}
 	}
 }
@@ -15,8 +15,11 @@
  */
 #pragma once
 
+#include <atomic>
+#include <chrono>
 #include <string>
 #include <memory>
+#include <vector>
 #include <queue>
 #include <mutex>
 #include <condition_variable>
@@ -35,9 +38,16 @@ typedef struct AVPacket AVPacket;
 
 class RTPStreamer {
 public:
-	explicit RTPStreamer(bool active, std::string uri, int framerate = 30);
+	/** codecs: encoder names in order of preference, threads: encoder threads (0: automatic) */
+	explicit RTPStreamer(bool active, std::string uri, int framerate = 30, int bitrate = 3500000, std::vector<std::string> codecs = {"h264_nvenc", "h264_qsv", "h264_vaapi", "libx264"}, int threads = 1);
 	~RTPStreamer();
+
+	/** Whether a frame should be sent now to keep the stream framerate. Frames are not converted to NV12 otherwise. */
+	bool frameDue();
 	void sendFrame(std::shared_ptr<RawImage> image);
+
+	/** CPU time of the encoder thread in s, excluding worker threads of the codec. */
+	double encodeCpuTime() const { return encodeCpuSeconds.load(std::memory_order_relaxed); }
 private:
 	void encoderRun();
 
@@ -47,7 +57,11 @@ private:
 	const bool active;
 	const std::string uri;
 	const int framerate;
-	const int frametime_us;
+	const int bitrate;
+	const std::vector<std::string> codecs;
+	const int threads;
+	const std::chrono::steady_clock::duration frametime;
+	std::chrono::steady_clock::time_point nextFrameTime;
 	int width = 0;
 	int height = 0;
 
@@ -55,9 +69,16 @@ private:
 	std::thread encoder;
 
 	std::shared_ptr<RawImage> queue = nullptr;
+	std::chrono::steady_clock::time_point queueTime;
 	std::mutex queueMutex = std::mutex();
 	std::condition_variable queueSignal = std::condition_variable();
-	long currentFrameId = 0;
+	std::chrono::steady_clock::time_point startTime;
+	int64_t lastPts = -1;
+
+	std::atomic<double> encodeCpuSeconds = 0.0;
+	double reportCpuSeconds = 0.0;
+	int reportFrames = 0;
+	std::chrono::steady_clock::time_point reportTime;
 
 	AVCodecContext* codecCtx = nullptr;
 	AVFormatContext* fmtCtx = nullptr;
@@ -0,0 +1,250 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "shmring.h"
+#include "log.h"
+
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+
+// Interval of the reader checks for a replaced shared memory object while no messages arrive
+static const std::chrono::seconds INODE_CHECK_INTERVAL(1);
+
+static size_t slotStride(const uint32_t slotSize) {
+	return (sizeof(ShmRingSlot) + slotSize + 63) & ~(size_t)63;
+}
+
+static ShmRingSlot* slot(ShmRingHeader* header, const uint64_t n, const uint32_t slotCount, const uint32_t slotSize) {
+	return (ShmRingSlot*)((uint8_t*)header + sizeof(ShmRingHeader) + (n % slotCount) * slotStride(slotSize));
+}
+
+static ShmRingSlot* slot(ShmRingHeader* header, const uint64_t n) {
+	return slot(header, n, header->slotCount, header->slotSize);
+}
+
+/** Marks the ring left behind by a crashed producer as dead so its consumers switch to the new object immediately. */
+static void invalidate(const std::string& name) {
+	const int fd = shm_open(name.c_str(), O_RDWR, 0);
+	if(fd < 0)
+		return;
+
+	struct stat stat = {};
+	if(fstat(fd, &stat) == 0 && (size_t)stat.st_size >= sizeof(ShmRingHeader)) {
+		void* memory = mmap(nullptr, sizeof(ShmRingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if(memory != MAP_FAILED) {
+			((ShmRingHeader*)memory)->magic.store(0, std::memory_order_release);
+			munmap(memory, sizeof(ShmRingHeader));
+		}
+	}
+	::close(fd);
+}
+
+ShmRing::ShmRing(const std::string& name, const uint32_t slotCount, const uint32_t slotSize): name(name) {
+	// Never resize an existing object in place: consumers still mapping it at the old size would fault on the truncated slots
+	invalidate(name);
+	shm_unlink(name.c_str());
+
+	const int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+	if(fd < 0) {
+		WARN("Could not create shared memory " << name << ": " << strerror(errno));
+		return;
+	}
+
+	mappedSize = sizeof(ShmRingHeader) + slotCount * slotStride(slotSize);
+	if(ftruncate(fd, (off_t)mappedSize) < 0) {
+		WARN("Could not resize shared memory " << name << ": " << strerror(errno));
+		::close(fd);
+		shm_unlink(name.c_str());
+		return;
+	}
+
+	void* memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(memory == MAP_FAILED) {
+		WARN("Could not map shared memory " << name << ": " << strerror(errno));
+		shm_unlink(name.c_str());
+		return;
+	}
+
+	// The fresh object is zero filled, magic is published last
+	header = (ShmRingHeader*)memory;
+	header->version = ShmRingHeader::VERSION;
+	header->slotCount = slotCount;
+	header->slotSize = slotSize;
+	header->magic.store(ShmRingHeader::MAGIC, std::memory_order_release);
+
+	LOG("Shared memory output /dev/shm" << name << " with " << slotCount << " slots");
+}
+
+ShmRing::~ShmRing() {
+	if(header == nullptr)
+		return;
+
+	header->magic.store(0, std::memory_order_release);
+	munmap(header, mappedSize);
+	shm_unlink(name.c_str());
+}
+
+void ShmRing::write(const google::protobuf::Message& msg) {
+	if(header == nullptr)
+		return;
+
+	const size_t size = msg.ByteSizeLong();
+	if(size > header->slotSize) {
+		WARN("Message of " << size << " bytes exceeds the shared memory slot size " << header->slotSize);
+		return;
+	}
+
+	const uint64_t n = header->head.load(std::memory_order_relaxed);
+	ShmRingSlot* s = slot(header, n);
+	s->sequence.store(2*n + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	msg.SerializeWithCachedSizesToArray(s->payload);
+	s->length = (uint32_t)size;
+	s->sequence.store(2*n + 2, std::memory_order_release);
+	header->head.store(n + 1, std::memory_order_release);
+
+	header->notify.fetch_add(1, std::memory_order_release);
+	syscall(SYS_futex, &header->notify, FUTEX_WAKE, INT_MAX, nullptr, nullptr, 0);
+}
+
+
+ShmRingReader::ShmRingReader(const std::string& name): name(name) {
+	map();
+}
+
+ShmRingReader::~ShmRingReader() {
+	unmap();
+}
+
+bool ShmRingReader::map() {
+	if(header != nullptr && header->magic.load(std::memory_order_acquire) == ShmRingHeader::MAGIC && header->slotCount == slotCount && header->slotSize == slotSize)
+		return true;
+
+	const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+	if(fd < 0)
+		return false;
+
+	struct stat stat = {};
+	if(fstat(fd, &stat) < 0 || (size_t)stat.st_size < sizeof(ShmRingHeader)) {
+		::close(fd);
+		return false;
+	}
+
+	void* memory = mmap(nullptr, stat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if(memory == MAP_FAILED)
+		return false;
+
+	auto* mapped = (ShmRingHeader*)memory;
+	const uint32_t mappedSlotCount = mapped->slotCount;
+	const uint32_t mappedSlotSize = mapped->slotSize;
+	if(mapped->magic.load(std::memory_order_acquire) != ShmRingHeader::MAGIC || mapped->version != ShmRingHeader::VERSION || mappedSlotCount == 0 || sizeof(ShmRingHeader) + mappedSlotCount * slotStride(mappedSlotSize) > (size_t)stat.st_size) {
+		munmap(memory, stat.st_size);
+		return false;
+	}
+
+	const bool restarted = inode != 0;
+	unmap();
+	header = mapped;
+	mappedSize = stat.st_size;
+	inode = stat.st_ino;
+	slotCount = mappedSlotCount;
+	slotSize = mappedSlotSize;
+	// A new reader starts with the next message, after a producer restart all messages of the new producer are read
+	next = header->head.load(std::memory_order_acquire);
+	if(restarted) {
+		next = next > slotCount ? next - slotCount : 0;
+		LOG("Shared memory ring " << name << " has been recreated, following the new producer");
+	}
+	return true;
+}
+
+void ShmRingReader::unmap() {
+	if(header != nullptr)
+		munmap(header, mappedSize);
+	header = nullptr;
+}
+
+bool ShmRingReader::read(std::string& data) {
+	if(!map())
+		return false;
+
+	while(true) {
+		const uint64_t head = header->head.load(std::memory_order_acquire);
+		if(head < next) // Stale position, the ring is never reset in place
+			next = head;
+		if(head == next) {
+			// A crashed producer leaves a valid ring behind, its replacement is only noticed by the changed inode
+			const auto now = std::chrono::steady_clock::now();
+			if(now - lastInodeCheck >= INODE_CHECK_INTERVAL) {
+				lastInodeCheck = now;
+				const int fd = shm_open(name.c_str(), O_RDONLY, 0);
+				struct stat stat = {};
+				const bool replaced = fd >= 0 && fstat(fd, &stat) == 0 && (uint64_t)stat.st_ino != inode;
+				if(fd >= 0)
+					::close(fd);
+				if(replaced) {
+					unmap();
+					if(!map())
+						return false;
+					continue;
+				}
+			}
+			return false;
+		}
+
+		if(head - next > slotCount) {
+			lost += head - next - slotCount;
+			next = head - slotCount;
+		}
+
+		const ShmRingSlot* s = slot(header, next, slotCount, slotSize);
+		const uint64_t expected = 2*next + 2;
+		next++;
+		if(s->sequence.load(std::memory_order_acquire) == expected) {
+			data.assign((const char*)s->payload, std::min(s->length, slotSize));
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if(s->sequence.load(std::memory_order_relaxed) == expected)
+				return true;
+		}
+
+		// Overwritten while reading
+		lost++;
+	}
+}
+
+void ShmRingReader::wait(const double timeout) {
+	if(!map()) {
+		// No producer to be notified by
+		std::this_thread::sleep_for(std::chrono::duration<double>(timeout));
+		return;
+	}
+
+	const uint32_t notify = header->notify.load(std::memory_order_acquire);
+	if(header->head.load(std::memory_order_acquire) != next)
+		return;
+
+	struct timespec time = {(time_t)timeout, (long)((timeout - (double)(time_t)timeout) * 1e9)};
+	syscall(SYS_futex, &header->notify, FUTEX_WAIT, notify, &time, nullptr, 0);
+}
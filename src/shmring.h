@@ -0,0 +1,104 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <google/protobuf/message.h>
+
+/*
+ * Single producer, multi consumer ring of serialized protobuf messages in POSIX shared memory (/dev/shm/<name>).
+ * Consumers never block the producer, a consumer that falls behind by more than slotCount messages loses the oldest.
+ * Layout (little endian, python/visionsocket.py SharedMemoryVision reads the same):
+ *   header (64 bytes): u32 magic, u32 version, u32 slotCount, u32 slotSize, u64 head (messages published), u32 notify
+ *   slot i at 64 + i*slotStride: u64 sequence, u32 length, u32 reserved, u8 payload[slotSize]
+ *   slotStride = 16 + slotSize rounded up to a multiple of 64 (65600 for slotSize 65536)
+ * Message n is stored in slot n % slotCount. Its sequence is 2n+1 while being written and 2n+2 once complete,
+ * a reader accepts the payload if the sequence was 2n+2 before and after copying it (seqlock).
+ * notify is incremented with each message and can be waited on with FUTEX_WAIT.
+ */
+struct ShmRingHeader {
+	static constexpr uint32_t MAGIC = 0x52535056; // "VPSR"
+	static constexpr uint32_t VERSION = 1;
+
+	std::atomic<uint32_t> magic;
+	uint32_t version;
+	uint32_t slotCount;
+	uint32_t slotSize;
+	std::atomic<uint64_t> head;
+	std::atomic<uint32_t> notify;
+	uint8_t reserved[36];
+};
+static_assert(sizeof(ShmRingHeader) == 64);
+static_assert(std::atomic<uint64_t>::is_always_lock_free && std::atomic<uint32_t>::is_always_lock_free);
+
+struct ShmRingSlot {
+	std::atomic<uint64_t> sequence;
+	uint32_t length;
+	uint32_t reserved;
+	uint8_t payload[];
+};
+
+/** Producer side, replaces any existing shared memory object of the same name with a fresh one. */
+class ShmRing {
+public:
+	ShmRing(const std::string& name, uint32_t slotCount, uint32_t slotSize);
+	~ShmRing();
+
+	/** Serializes msg directly into the next slot and wakes waiting consumers. */
+	void write(const google::protobuf::Message& msg);
+
+private:
+	std::string name;
+	ShmRingHeader* header = nullptr;
+	size_t mappedSize = 0;
+};
+
+/**
+ * Consumer side, starts with the next published message. Follows producer restarts: the shared memory object is
+ * remapped once its magic is cleared (clean shutdown or a restarting producer) or its name points to a new inode.
+ */
+class ShmRingReader {
+public:
+	explicit ShmRingReader(const std::string& name);
+	~ShmRingReader();
+
+	/** Copies the next message into data. Returns false if none is available, lost counts overwritten messages. */
+	bool read(std::string& data);
+	/** Blocks until a message has been published after the last read or timeout (seconds) elapsed. */
+	void wait(double timeout);
+
+	[[nodiscard]] bool valid() const { return header != nullptr; }
+
+	uint64_t lost = 0;
+
+private:
+	/** Maps the current shared memory object unless the existing mapping is still the published ring. */
+	bool map();
+	void unmap();
+
+	const std::string name;
+	ShmRingHeader* header = nullptr;
+	size_t mappedSize = 0;
+	uint64_t inode = 0;
+	std::chrono::steady_clock::time_point lastInodeCheck;
+	// Ring geometry of the mapping, validated against mappedSize
+	uint32_t slotCount = 0;
+	uint32_t slotSize = 0;
+	uint64_t next = 0;
+};
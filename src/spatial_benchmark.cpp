@@ -0,0 +1,92 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include <random>
+#include <algorithm>
+#include "blobs/kdtree.h"
+#include "blobs/blobgrid.h"
+#include "driver/cameradriver.h"
+
+// Typical per camera visible field area in mm and default search radii
+static const float AREA_LENGTH = 6000.0f;
+static const float AREA_WIDTH = 4500.0f;
+static const float MAX_ROBOT_RADIUS = 90.0f;
+static const float TRACKING_RADIUS = 40.0f;
+static const int TRACKED_OBJECTS = 22;
+static const int FRAMES = 200;
+
+struct Timing {
+	double build = 0.0;
+	double query = 0.0;
+	long results = 0;
+};
+
+template<typename Index>
+static std::vector<std::vector<Match*>> query(const Index& index, std::vector<Match>& matches, const std::vector<Eigen::Vector2f>& tracked, Timing& timing) {
+	std::vector<std::vector<Match*>> results(matches.size() + tracked.size());
+	double startTime = getRealTime();
+	for(size_t i = 0; i < matches.size(); i++)
+		index.rangeSearch(results[i], matches[i].pos, MAX_ROBOT_RADIUS);
+	for(size_t i = 0; i < tracked.size(); i++)
+		index.rangeSearch(results[matches.size() + i], tracked[i], TRACKING_RADIUS);
+	timing.query += getRealTime() - startTime;
+
+	for(std::vector<Match*>& result : results) {
+		std::sort(result.begin(), result.end());
+		timing.results += (long)result.size();
+	}
+	return results;
+}
+
+int main() {
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> xDist(-AREA_LENGTH/2, AREA_LENGTH/2);
+	std::uniform_real_distribution<float> yDist(-AREA_WIDTH/2, AREA_WIDTH/2);
+
+	for(const int blobAmount : {100, 500, 2000}) {
+		Timing tree;
+		Timing grid;
+		int mismatches = 0;
+
+		for(int frame = 0; frame < FRAMES; frame++) {
+			std::vector<Match> matches(blobAmount);
+			for(Match& match : matches)
+				match.pos = {xDist(rng), yDist(rng)};
+
+			std::vector<Eigen::Vector2f> tracked(5*TRACKED_OBJECTS);
+			for(Eigen::Vector2f& pos : tracked)
+				pos = {xDist(rng), yDist(rng)};
+
+			double startTime = getRealTime();
+			KDTree kdTree(&matches[0]);
+			for(int i = 1; i < blobAmount; i++)
+				kdTree.insert(&matches[i]);
+			tree.build += getRealTime() - startTime;
+
+			startTime = getRealTime();
+			BlobGrid blobGrid(matches, MAX_ROBOT_RADIUS);
+			grid.build += getRealTime() - startTime;
+
+			if(query(kdTree, matches, tracked, tree) != query(blobGrid, matches, tracked, grid))
+				mismatches++;
+		}
+
+		std::cout << "[Spatial benchmark] " << blobAmount << " blobs, " << (tree.results / FRAMES) << " results/frame" << std::endl;
+		std::cout << "[Spatial benchmark]   KDTree   build " << tree.build / FRAMES * 1e6 << " us query " << tree.query / FRAMES * 1e6 << " us" << std::endl;
+		std::cout << "[Spatial benchmark]   BlobGrid build " << grid.build / FRAMES * 1e6 << " us query " << grid.query / FRAMES * 1e6 << " us" << std::endl;
+		if(mismatches)
+			std::cout << "[Spatial benchmark]   result mismatch in " << mismatches << "/" << FRAMES << " frames" << std::endl;
+	}
+}
@@ -0,0 +1,93 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#include "threadpool.h"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(const int threads) {
+	for(int i = 1; i < threads; i++)
+		workers.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mu);
+		stop = true;
+	}
+	start.notify_all();
+	for(std::thread& worker : workers)
+		worker.join();
+}
+
+void ThreadPool::parallelFor(const int n, const std::function<void(int, int)>& fn) {
+	if(workers.empty() || n <= 1) {
+		for(int i = 0; i < n; i++)
+			fn(i, 0);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mu);
+		task = &fn;
+		amount = n;
+		// Small chunks keep the threads balanced when a few indices (crowded areas) are much more expensive
+		chunk = std::max(1, n / (size() * 16));
+		next = 0;
+		running = (int)workers.size();
+		generation++;
+	}
+	start.notify_all();
+
+	work(0);
+
+	std::unique_lock<std::mutex> lock(mu);
+	done.wait(lock, [&]() { return running == 0; });
+	task = nullptr;
+}
+
+void ThreadPool::work(const int thread) {
+	while(true) {
+		const int begin = next.fetch_add(chunk);
+		if(begin >= amount)
+			return;
+
+		const int end = std::min(begin + chunk, amount);
+		for(int i = begin; i < end; i++)
+			(*task)(i, thread);
+	}
+}
+
+void ThreadPool::run(const int thread) {
+	int seenGeneration = 0;
+	while(true) {
+		{
+			std::unique_lock<std::mutex> lock(mu);
+			start.wait(lock, [&]() { return generation != seenGeneration || stop; });
+			if(stop)
+				return;
+			seenGeneration = generation;
+		}
+
+		work(thread);
+
+		{
+			std::lock_guard<std::mutex> lock(mu);
+			running--;
+		}
+		done.notify_one();
+	}
+}
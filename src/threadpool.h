@@ -0,0 +1,54 @@
+/*
+     Copyright 2026 Felix Weinmann
+
+     Licensed under the Apache License, Version 2.0 (the "License");
+     you may not use this file except in compliance with the License.
+     You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+     Unless required by applicable law or agreed to in writing, software
+     distributed under the License is distributed on an "AS IS" BASIS,
+     WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+     See the License for the specific language governing permissions and
+     limitations under the License.
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class ThreadPool {
+public:
+	// threads includes the calling thread, 1 runs everything inline
+	explicit ThreadPool(int threads);
+	~ThreadPool();
+
+	// Calls task(index, thread) for every index in [0, n) and blocks until all are done.
+	// Idle threads claim the next chunk of indices, thread in [0, size()) selects per-thread scratch buffers.
+	void parallelFor(int n, const std::function<void(int index, int thread)>& task);
+
+	[[nodiscard]] int size() const { return (int)workers.size() + 1; }
+
+private:
+	void run(int thread);
+	void work(int thread);
+
+	std::vector<std::thread> workers;
+	std::mutex mu;
+	std::condition_variable start;
+	std::condition_variable done;
+
+	const std::function<void(int, int)>* task = nullptr;
+	int amount = 0;
+	int chunk = 1;
+	std::atomic<int> next = 0;
+	int generation = 0;
+	int running = 0;
+	bool stop = false;
+};
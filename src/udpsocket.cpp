@@ -17,12 +17,28 @@
 #include "proto/ssl_vision_wrapper.pb.h"
 #include "proto/ssl_gc_referee_message.pb.h"
 #include "driver/cameradriver.h"
+#include "fastmath.h"
 
 #include <cmath>
 #include "log.h"
 #include <cstring>
+#include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/util/message_differencer.h>
-#include <mutex>
+#include <string_view>
+
+// Bot Kalman filter parameters
+static const float POSITION_NOISE = 10.0f; // mm, standard deviation of detected positions
+static const float ORIENTATION_NOISE = 0.05f; // rad
+static const float INITIAL_SPEED = 3000.0f; // mm/s, velocity standard deviation of a newly tracked bot
+static const float INITIAL_ANGULAR_SPEED = 10.0f; // rad/s
+static const float TRACKING_GATE = 25.0f; // squared position innovation in variances (5 sigma) to accept a detection
+static const double TRACKING_TIMEOUT = 0.1; // s without detection until a bot is no longer tracked
+
+// Protobuf wire types used by the SSL_WrapperPacket scan
+static const uint32_t WIRETYPE_VARINT = 0;
+static const uint32_t WIRETYPE_FIXED64 = 1;
+static const uint32_t WIRETYPE_LENGTH_DELIMITED = 2;
+static const uint32_t WIRETYPE_FIXED32 = 5;
 
 UDPSocket::UDPSocket(const std::string& ip, uint16_t port) {
 	//Adapted from https://gist.github.com/hostilefork/f7cae3dc33e7416f2dd25a402857b6c6
@@ -61,6 +77,14 @@ UDPSocket::UDPSocket(const std::string& ip, uint16_t port) {
 		WARN("Setting SO_BROADCAST on UDP socket failed");
 	}
 
+	if (setsockopt(socket_, SOL_SOCKET, SO_TIMESTAMPNS, (char*) &yes, sizeof(yes)) < 0) {
+		WARN("Setting SO_TIMESTAMPNS on UDP socket failed, using receive thread timestamps");
+	}
+
+	if (setsockopt(socket_, SOL_SOCKET, SO_RXQ_OVFL, (char*) &yes, sizeof(yes)) < 0) {
+		WARN("Setting SO_RXQ_OVFL on UDP socket failed, drops are not counted");
+	}
+
 	int ttl = 32; 
 	if (setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, (char*) &ttl, sizeof(ttl)) < 0) {
 		WARN("Setting TTL failed");
@@ -91,122 +115,279 @@ UDPSocket::~UDPSocket() {
 #endif
 }
 
+// Datagrams per recvmmsg call and their maximum size
+static const int RECV_BATCH = 16;
+static const int RECV_SIZE = 65535;
+// Messages per sendmmsg call
+static const int SEND_BATCH = 4;
+// Serialization buffers of the sending thread, grown to the largest message and never shrunk
+static thread_local std::vector<uint8_t> sendBuffers[SEND_BATCH];
+
+static uint8_t* serialize(const google::protobuf::Message& msg, std::vector<uint8_t>& buffer, size_t& size) {
+	size = msg.ByteSizeLong();
+	if(buffer.size() < size)
+		buffer.resize(size);
+
+	msg.SerializeWithCachedSizesToArray(buffer.data());
+	return buffer.data();
+}
+
 void UDPSocket::send(const google::protobuf::Message& msg) {
-	std::string str;
-	msg.SerializeToString(&str);
-	if(sendto(socket_, str.data(), str.length(), 0, &addr_, sizeof(addr_)) < 0) {
+	size_t size;
+	const uint8_t* data = serialize(msg, sendBuffers[0], size);
+	if(sendto(socket_, data, size, 0, &addr_, sizeof(addr_)) < 0) {
 		WARN("UDP Frame send failed: " << strerror(errno) << " " << strerrorname_np(errno));
 	}
 }
 
+void UDPSocket::send(const std::initializer_list<const google::protobuf::Message*> msgs) {
+	struct mmsghdr headers[SEND_BATCH];
+	struct iovec iovecs[SEND_BATCH];
+
+	auto msg = msgs.begin();
+	while(msg != msgs.end()) {
+		int n = 0;
+		for(; msg != msgs.end() && n < SEND_BATCH; msg++, n++) {
+			size_t size;
+			iovecs[n].iov_base = serialize(**msg, sendBuffers[n], size);
+			iovecs[n].iov_len = size;
+			headers[n] = {};
+			headers[n].msg_hdr.msg_name = &addr_;
+			headers[n].msg_hdr.msg_namelen = sizeof(addr_);
+			headers[n].msg_hdr.msg_iov = &iovecs[n];
+			headers[n].msg_hdr.msg_iovlen = 1;
+		}
+
+		for(int sent = 0; sent < n;) {
+			const int result = sendmmsg(socket_, headers + sent, n - sent, 0);
+			if(result < 0) {
+				WARN("UDP Frame send failed: " << strerror(errno) << " " << strerrorname_np(errno));
+				return;
+			}
+			sent += result;
+		}
+	}
+}
+
 void UDPSocket::run() {
+	// Bursts of datagrams are received with a single recvmmsg call into reused buffers
+	std::vector<char> buffers(RECV_BATCH * RECV_SIZE);
+	// CMSG_FIRSTHDR/CMSG_NXTHDR access the buffers as struct cmsghdr, CMSG_SPACE keeps every row a multiple of its alignment
+	alignas(struct cmsghdr) char controls[RECV_BATCH][CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(sizeof(uint32_t))];
+	static_assert(sizeof(controls[0]) % alignof(struct cmsghdr) == 0);
+	struct iovec iovecs[RECV_BATCH];
+	struct mmsghdr headers[RECV_BATCH];
+
 	while(true) {
-		char msgbuf[65535];
+		for(int i = 0; i < RECV_BATCH; i++) {
+			iovecs[i].iov_base = buffers.data() + i * RECV_SIZE;
+			iovecs[i].iov_len = RECV_SIZE;
+			headers[i] = {};
+			headers[i].msg_hdr.msg_iov = &iovecs[i];
+			headers[i].msg_hdr.msg_iovlen = 1;
+			headers[i].msg_hdr.msg_control = controls[i];
+			headers[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+		}
 
-		int bytesRead = read(socket_, msgbuf, 65535);
+		const int received = recvmmsg(socket_, headers, RECV_BATCH, MSG_WAITFORONE, nullptr);
 		if(closing)
 			return;
 
-		if (bytesRead < 0) {
+		if (received < 0) {
+			if(errno == EINTR)
+				continue;
+
 			WARN("UDP Frame recv failed: " << strerror(errno) << " " << strerrorname_np(errno));
 			return;
 		}
 
-		parse(msgbuf, bytesRead);
+		const double fallbackTime = getRealTime();
+		for(int i = 0; i < received; i++) {
+			if(headers[i].msg_hdr.msg_flags & MSG_TRUNC)
+				continue;
+
+			double receiveTime = fallbackTime;
+			for(struct cmsghdr* cmsg = CMSG_FIRSTHDR(&headers[i].msg_hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(&headers[i].msg_hdr, cmsg)) {
+				if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+					struct timespec timestamp;
+					memcpy(&timestamp, CMSG_DATA(cmsg), sizeof(timestamp));
+					// CLOCK_REALTIME like the clock of getRealTime()
+					receiveTime = (double)timestamp.tv_sec + (double)timestamp.tv_nsec / 1e9 + realTimeOffset;
+				} else if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+					// Total drops of the socket, wraps around at 2^32
+					uint32_t drops;
+					memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+					datagramsDropped.store(drops, std::memory_order_relaxed);
+				}
+			}
+
+			datagramsReceived.fetch_add(1, std::memory_order_relaxed);
+			parse((char*)iovecs[i].iov_base, (int)headers[i].msg_len, receiveTime);
+		}
 	}
 }
 
+double UDPSocket::receiverCpuTime() {
+	clockid_t clock;
+	struct timespec time;
+	if(pthread_getcpuclockid(receiver.native_handle(), &clock) || clock_gettime(clock, &time))
+		return 0.0;
+
+	return (double)time.tv_sec + (double)time.tv_nsec / 1e9;
+}
+
 void VisionSocket::geometryCheck() {
-	geometryMutex.lock();
-	if(!google::protobuf::util::MessageDifferencer::Equals(receivedGeometry, geometry)) {
-		geometry.CopyFrom(receivedGeometry);
-		if(geometry.field().has_ball_radius())
-			ballRadius = geometry.field().ball_radius();
+	const int version = receivedGeometryVersion.load(std::memory_order_acquire);
+	if(version == checkedGeometryVersion)
+		return;
 
+	checkedGeometryVersion = version;
+	std::shared_ptr<const SSL_GeometryData> received = receivedGeometry.load();
+	if(received != geometry) {
+		geometry = std::move(received);
 		geometryVersion++;
 		LOG("New geometry received");
 	}
-	geometryMutex.unlock();
 }
 
-std::map<unsigned int, std::vector<TrackingState>> VisionSocket::getTrackedObjects() {
-	trackedMutex.lock();
-	std::map<unsigned int, std::vector<TrackingState>> copy = trackedObjects;
-	trackedMutex.unlock();
-	return copy;
+std::shared_ptr<const std::vector<float>> VisionSocket::getReceivedOffsets() const {
+	std::shared_ptr<const TimeOffsets> offsets = timeOffsets.load();
+	return {offsets, &offsets->received};
 }
 
-std::vector<float> VisionSocket::getReceivedOffsets() {
-	offsetMutex.lock();
-	std::vector<float> copy = receivedOffsets;
-	offsetMutex.unlock();
-	return copy;
-}
 
+void VisionSocket::parse(char *data, int length, const double receiveTime) {
+	// Locate the SSL_WrapperPacket submessages without parsing them
+	std::string_view detectionData;
+	std::string_view geometryData;
+	google::protobuf::io::CodedInputStream input((const uint8_t*)data, length);
+	while(const uint32_t tag = input.ReadTag()) {
+		// Protobuf wire format: field number and wire type are encoded in the tag
+		const uint32_t field = tag >> 3;
+		const uint32_t wireType = tag & 7;
+		uint32_t size;
+		uint64_t varint;
+		switch(wireType) {
+			case WIRETYPE_VARINT:
+				if(!input.ReadVarint64(&varint))
+					return;
+				continue;
+			case WIRETYPE_FIXED64:
+				if(!input.Skip(8))
+					return;
+				continue;
+			case WIRETYPE_FIXED32:
+				if(!input.Skip(4))
+					return;
+				continue;
+			case WIRETYPE_LENGTH_DELIMITED:
+				if(!input.ReadVarint32(&size))
+					return;
+				break;
+			default: // Groups are not used by SSL_WrapperPacket
+				return;
+		}
 
-void VisionSocket::parse(char *data, int length) {
-	SSL_WrapperPacket wrapper;
-	wrapper.ParseFromArray(data, length);
+		const int position = input.CurrentPosition();
+		if(size > (uint32_t)(length - position))
+			return;
 
-	if(wrapper.has_detection()) {
-		timeSynchronization(wrapper.detection());
-		detectionTracking(wrapper.detection());
+		if(field == SSL_WrapperPacket::kDetectionFieldNumber)
+			detectionData = std::string_view(data + position, size);
+		else if(field == SSL_WrapperPacket::kGeometryFieldNumber)
+			geometryData = std::string_view(data + position, size);
+		input.Skip((int)size);
 	}
 
-	if(wrapper.has_geometry()) {
-		if(!google::protobuf::util::MessageDifferencer::Equals(receivedGeometry, wrapper.geometry())) {
-			geometryMutex.lock();
-			receivedGeometry.CopyFrom(wrapper.geometry());
-			geometryMutex.unlock();
+	if(detectionData.data() != nullptr) {
+		// Reuses the arena blocks of the previous packet
+		arena.Reset();
+		auto* detection = google::protobuf::Arena::Create<SSL_DetectionFrame>(&arena);
+		if(detection->ParseFromArray(detectionData.data(), (int)detectionData.size())) {
+			timeSynchronization(*detection, receiveTime);
+			detectionTracking(*detection);
 		}
 	}
-}
 
-static void trackBots(const double timestamp, const float defaultBotHeight, const google::protobuf::RepeatedPtrField<SSL_DetectionRobot>& bots, const std::vector<TrackingState>& previous, std::vector<TrackingState>& objects, int idOffset) {
-	for (const SSL_DetectionRobot& bot : bots) {
-		float height = bot.has_height() ? bot.height() : defaultBotHeight;
+	// Geometry is sent continuously by every camera and the publisher, it is only parsed if the serialized bytes changed
+	if(geometryData.data() != nullptr) {
+		const size_t hash = std::hash<std::string_view>{}(geometryData);
+		if(hash == receivedGeometryHash)
+			return;
 
-		double nextDistance = INFINITY;
-		const TrackingState* nextOldBot = nullptr;
-		for(const TrackingState& oldBot : previous) {
-			if(oldBot.id != (int)bot.robot_id() + idOffset)
-				continue;
+		auto geometry = std::make_shared<SSL_GeometryData>();
+		if(!geometry->ParseFromArray(geometryData.data(), (int)geometryData.size()))
+			return;
 
-			float dX = bot.x() - oldBot.x;
-			float dY = bot.y() - oldBot.y;
-			double distance = dX*dX + dY*dY;
-			if(distance > nextDistance)
-				continue;
+		receivedGeometryHash = hash;
+		// A different serialization of the same geometry (e.g. another sender) is not a change
+		if(google::protobuf::util::MessageDifferencer::Equals(*receivedGeometry.load(), *geometry))
+			return;
 
-			nextDistance = distance;
-			nextOldBot = &oldBot;
-		}
+		if(geometry->field().has_ball_radius())
+			ballRadius = geometry->field().ball_radius();
 
-		if(nextOldBot == nullptr) {
-			objects.push_back({
-				(int)bot.robot_id() + idOffset, timestamp,
-				bot.x(), bot.y(), height, bot.orientation(),
-				0.0f, 0.0f, 0.0f, 0.0f,
-				bot.confidence(), 1
-			});
+		receivedGeometry.store(std::move(geometry));
+		receivedGeometryVersion.fetch_add(1, std::memory_order_release);
+	}
+}
+
+void VisionSocket::trackBots(const double timestamp, const google::protobuf::RepeatedPtrField<SSL_DetectionRobot>& bots, const int idOffset) {
+	const float positionVariance = POSITION_NOISE * POSITION_NOISE;
+	const float orientationVariance = ORIENTATION_NOISE * ORIENTATION_NOISE;
+
+	for (const SSL_DetectionRobot& bot : bots) {
+		if(bot.robot_id() >= 16)
+			continue;
+
+		BotFilter& filter = botFilters[bot.robot_id() + idOffset];
+		if(filter.age == 0 || timestamp - filter.timestamp > TRACKING_TIMEOUT) {
+			filter.x.reset(bot.x(), positionVariance, INITIAL_SPEED * INITIAL_SPEED);
+			filter.y.reset(bot.y(), positionVariance, INITIAL_SPEED * INITIAL_SPEED);
+			filter.w.reset(bot.orientation(), orientationVariance, INITIAL_ANGULAR_SPEED * INITIAL_ANGULAR_SPEED);
+			filter.timestamp = timestamp;
+			filter.age = 0;
 		} else {
-			auto timeDelta = (float)(timestamp - nextOldBot->timestamp);
-			objects.push_back({
-				nextOldBot->id, timestamp,
-				bot.x(), bot.y(), height, bot.orientation(),
-				(bot.x() - nextOldBot->x) / timeDelta, (bot.y() - nextOldBot->y) / timeDelta, 0.0f, (bot.orientation() - nextOldBot->w) / timeDelta,
-				bot.confidence(), nextOldBot->age + 1
-			});
+			// Frames of other cameras can arrive out of order, those are applied at the filter time
+			const auto timeDelta = (float)std::max(timestamp - filter.timestamp, 0.0);
+			KalmanAxis x = filter.x;
+			KalmanAxis y = filter.y;
+			KalmanAxis w = filter.w;
+			const float acceleration = getMaxBotAcceleration();
+			const float angularAcceleration = getMaxBotAngularAcceleration();
+			x.predict(timeDelta, acceleration * acceleration);
+			y.predict(timeDelta, acceleration * acceleration);
+			w.predict(timeDelta, angularAcceleration * angularAcceleration);
+
+			// Detections far off the prediction are misidentified bots, not updates of this one
+			const float dx = bot.x() - x.position;
+			const float dy = bot.y() - y.position;
+			if((dx*dx + dy*dy) / x.innovationVariance(positionVariance) > TRACKING_GATE)
+				continue;
+
+			x.update(dx, positionVariance);
+			y.update(dy, positionVariance);
+			w.update(wrapAngle(bot.orientation() - w.position), orientationVariance);
+			w.position = wrapAngle(w.position);
+			filter.x = x;
+			filter.y = y;
+			filter.w = w;
+			filter.timestamp = std::max(filter.timestamp, timestamp);
 		}
+
+		filter.height = bot.has_height() ? bot.height() : defaultBotHeight;
+		filter.confidence = bot.confidence();
+		filter.age++;
 	}
 }
 
 void VisionSocket::detectionTracking(const SSL_DetectionFrame &detection) {
 	const double timestamp = detection.t_capture();
 
-	trackedMutex.lock();
-	const std::vector<TrackingState> previous = trackedObjects[detection.camera_id()];
-	trackedMutex.unlock();
+	static const std::vector<TrackingState> none;
+	const std::shared_ptr<const TrackedObjects> snapshot = trackedObjects.load();
+	const auto previousEntry = snapshot->balls.find(detection.camera_id());
+	const std::vector<TrackingState>& previous = previousEntry != snapshot->balls.end() ? *previousEntry->second : none;
 	std::vector<TrackingState> objects;
 
 	for (const auto& ball : detection.balls()) {
@@ -247,28 +428,49 @@ void VisionSocket::detectionTracking(const SSL_DetectionFrame &detection) {
 		}
 	}
 
-	trackBots(timestamp, defaultBotHeight, detection.robots_yellow(), previous, objects, 0);
-	trackBots(timestamp, defaultBotHeight, detection.robots_blue(), previous, objects, 16);
-
-	trackedMutex.lock();
-	trackedObjects[detection.camera_id()] = objects;
-	trackedMutex.unlock();
+	latestTimestamp = std::max(latestTimestamp, timestamp);
+	trackBots(timestamp, detection.robots_yellow(), 0);
+	trackBots(timestamp, detection.robots_blue(), 16);
+
+	// Copies only the per camera ball pointers, the vectors of the other cameras are shared with the previous snapshot
+	auto next = std::make_shared<TrackedObjects>();
+	next->balls = snapshot->balls;
+	next->balls[detection.camera_id()] = std::make_shared<const std::vector<TrackingState>>(std::move(objects));
+	for(int id = 0; id < (int)botFilters.size(); id++) {
+		const BotFilter& filter = botFilters[id];
+		if(filter.age == 0 || latestTimestamp - filter.timestamp > TRACKING_TIMEOUT)
+			continue;
+
+		next->bots.push_back({
+			id, filter.timestamp,
+			filter.x.position, filter.y.position, filter.height, filter.w.position,
+			filter.x.velocity, filter.y.velocity, 0.0f, filter.w.velocity,
+			filter.confidence, filter.age,
+			{filter.x.covariance[0], filter.x.covariance[1], filter.x.covariance[2]},
+			{filter.w.covariance[0], filter.w.covariance[1], filter.w.covariance[2]}
+		});
+	}
+	trackedObjects.store(std::move(next));
 }
 
 
+void VisionSocket::setMaxBotAcceleration(const float acceleration, const float angularAcceleration) {
+	maxBotAcceleration.store(acceleration, std::memory_order_relaxed);
+	maxBotAngularAcceleration.store(angularAcceleration, std::memory_order_relaxed);
+}
+
 void VisionSocket::updateTime() {
-	offsetMutex.lock();
+	const std::shared_ptr<const TimeOffsets> offsets = timeOffsets.load();
 
 	double offset = 0.0;
-	const int cams = (int)receivedOffsets.size();
+	const int cams = (int)offsets->received.size();
 	for (int cam = 0; cam < cams; cam++) {
 		if (cam == camId)
 			continue; // Don't synchronize with yourself
 
-		offset += receivedOffsets[cam] - sentOffsets[cam];
+		offset += offsets->received[cam] - offsets->sent[cam];
 	}
 
-	offsetMutex.unlock();
 	if (cams == 0)
 		return;
 
@@ -281,23 +483,22 @@ void VisionSocket::updateTime() {
 	realTimeOffset += offset;
 }
 
-void VisionSocket::timeSynchronization(const SSL_DetectionFrame& detection) {
-	const double localTime = getRealTime();
+void VisionSocket::timeSynchronization(const SSL_DetectionFrame& detection, const double receiveTime) {
 	const unsigned int senderId = detection.camera_id();
 
-	offsetMutex.lock();
+	auto offsets = std::make_shared<TimeOffsets>(*timeOffsets.load());
 
-	while(receivedOffsets.size() <= senderId) {
-		receivedOffsets.push_back(0.0f);
-		sentOffsets.push_back(0.0f);
+	while(offsets->received.size() <= senderId) {
+		offsets->received.push_back(0.0f);
+		offsets->sent.push_back(0.0f);
 	}
 
-	receivedOffsets[senderId] = (float)(detection.t_sent() - localTime);
+	offsets->received[senderId] = (float)(detection.t_sent() - receiveTime);
 
 	if (detection.t_offsets_size() > this->camId)
-		sentOffsets[senderId] = detection.t_offsets(this->camId);
+		offsets->sent[senderId] = detection.t_offsets(this->camId);
 
-	offsetMutex.unlock();
+	timeOffsets.store(std::move(offsets));
 }
 
 
@@ -313,7 +514,7 @@ GCSocket::GCSocket(const std::string &ip, uint16_t port, const std::map<std::str
 	blueBotHeight = defaultBotHeight;
 }
 
-void GCSocket::parse(char *data, int length) {
+void GCSocket::parse(char *data, int length, double receiveTime) {
 	Referee referee;
 	referee.ParseFromArray(data, length);
 
@@ -16,11 +16,19 @@
 #pragma once
 
 
-#include <thread>
+#include <array>
+#include <atomic>
+#include <initializer_list>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <thread>
+#include <vector>
+#include <google/protobuf/arena.h>
 #include <google/protobuf/message.h>
 #include "proto/ssl_vision_geometry.pb.h"
 #include "proto/ssl_vision_detection.pb.h"
+#include "kalman.h"
 
 #ifdef _WIN32
 #include <Winsock2.h> // before Windows.h, else Winsock 1 conflict
@@ -40,19 +48,60 @@ public:
 	virtual ~UDPSocket();
 
 	void send(const google::protobuf::Message& msg);
+	/** Sends each message as its own datagram with a single syscall (sendmmsg). */
+	void send(std::initializer_list<const google::protobuf::Message*> msgs);
+
+	/** CPU time of the receiver thread in s. */
+	double receiverCpuTime();
+	/** Datagrams passed to parse. */
+	uint64_t receivedDatagrams() const { return datagramsReceived.load(std::memory_order_relaxed); }
+	/** Datagrams dropped by the kernel because the socket receive buffer was full (SO_RXQ_OVFL). */
+	uint64_t droppedDatagrams() const { return datagramsDropped.load(std::memory_order_relaxed); }
 
 private:
-	virtual void parse(char* data, int length) = 0;
+	/** receiveTime: kernel receive timestamp in the getRealTime() clock. */
+	virtual void parse(char* data, int length, double receiveTime) = 0;
 	void run();
 
 	bool closing = false;
 	int socket_;
 	struct sockaddr addr_ = {};
 
+	std::atomic<uint64_t> datagramsReceived = 0;
+	std::atomic<uint64_t> datagramsDropped = 0;
+
 	std::thread receiver;
 };
 
 
+/**
+ * Shared pointer to an immutable snapshot, replaced by one writer and copied by readers. The mutex is only held for the
+ * pointer copy (std::atomic<std::shared_ptr> requires libstdc++ 12 and is not lock free either).
+ */
+template<typename T>
+class Snapshot {
+public:
+	explicit Snapshot(std::shared_ptr<const T> value): value(std::move(value)) {}
+
+	std::shared_ptr<const T> load() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return value;
+	}
+
+	void store(std::shared_ptr<const T> next) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			value.swap(next);
+		}
+		// The previous snapshot is released outside of the lock
+	}
+
+private:
+	mutable std::mutex mutex;
+	std::shared_ptr<const T> value;
+};
+
+
 /** Internal detection wrapper for position prediction (tracking). */
 struct TrackingState {
 	int id; // -1: ball, 0-15: yellow bot, 16-31: blue bot
@@ -61,55 +110,110 @@ struct TrackingState {
 	float vx, vy, vz, vw;
 	float confidence;
 	int age;
+	// Kalman filter covariances at timestamp (see KalmanAxis), zero for balls
+	float positionCovariance[3]; // x and y share the covariance
+	float orientationCovariance[3];
+};
+
+struct TrackedObjects {
+	/** Balls per camera id, tracked from two frame differences. */
+	std::map<unsigned int, std::shared_ptr<const std::vector<TrackingState>>> balls;
+	/** Bots with Kalman filters fused over the detections of all cameras, sorted by id. */
+	std::vector<TrackingState> bots;
 };
 
 
 /** Socket handling vision messages. */
 class VisionSocket: public UDPSocket {
 public:
-	VisionSocket(const std::string &ip, uint16_t port, int camId, float defaultBotHeight): UDPSocket(ip, port), camId(camId), defaultBotHeight(defaultBotHeight) {}
+	VisionSocket(const std::string &ip, uint16_t port, int camId, float defaultBotHeight, float maxBotAcceleration, float maxBotAngularAcceleration): UDPSocket(ip, port), camId(camId), defaultBotHeight(defaultBotHeight), maxBotAcceleration(maxBotAcceleration), maxBotAngularAcceleration(maxBotAngularAcceleration), arena(arenaBlock, sizeof(arenaBlock)) {}
 
 	/** Check if a new geometry update has been received and update geometry and geometryVersion accordingly. */
 	void geometryCheck();
 	int getGeometryVersion() const { return geometryVersion; }
-	SSL_GeometryData& getGeometry() { return geometry; }
+	/** Geometry of the last geometryCheck, should only be accessed by the thread calling geometryCheck. */
+	const SSL_GeometryData& getGeometry() const { return *geometry; }
+
+	/** Immutable snapshot of the currently tracked objects, never blocks the receiver. */
+	std::shared_ptr<const TrackedObjects> getTrackedObjects() const { return trackedObjects.load(); }
 
-	std::map<unsigned int, std::vector<TrackingState>> getTrackedObjects();
+	/** Process noise of the bot Kalman filters, updated on config reloads. Tracking radii must use the same values. */
+	void setMaxBotAcceleration(float acceleration, float angularAcceleration);
+	float getMaxBotAcceleration() const { return maxBotAcceleration.load(std::memory_order_relaxed); }
+	float getMaxBotAngularAcceleration() const { return maxBotAngularAcceleration.load(std::memory_order_relaxed); }
 
 	/** Update the clock time offset. */
 	void updateTime();
-	std::vector<float> getReceivedOffsets();
+	/** Immutable snapshot of the time offsets reported by other cameras (other.t_sent - local.time). */
+	std::shared_ptr<const std::vector<float>> getReceivedOffsets() const;
 private:
-	void parse(char* data, int length) override;
+	/** Time offsets measured relative to or reported by other cameras. */
+	struct TimeOffsets {
+		std::vector<float> sent; // local.t_sent - other.time
+		std::vector<float> received; // other.t_sent - local.time
+	};
+
+	void parse(char* data, int length, double receiveTime) override;
 
 	/** Update trackedObjects with the contents of the DetectionFrame. */
 	void detectionTracking(const SSL_DetectionFrame& detection);
+	/** Update botFilters with the detected bots of one team. */
+	void trackBots(double timestamp, const google::protobuf::RepeatedPtrField<SSL_DetectionRobot>& bots, int idOffset);
 	/** Synchronize the time with the timestamps and offsets from the DetectionFrame. */
-	void timeSynchronization(const SSL_DetectionFrame& detection);
+	void timeSynchronization(const SSL_DetectionFrame& detection, double receiveTime);
 
 	/** Camera id of this socket. */
 	const int camId;
 	/** Default bot height to be used if the bot height is missing from received detection frames. */
 	const float defaultBotHeight;
+	/** Process noise of the bot Kalman filters in mm/s² and rad/s². */
+	std::atomic<float> maxBotAcceleration;
+	std::atomic<float> maxBotAngularAcceleration;
+
+	/** Kalman filter state of a bot, see TrackingState. */
+	struct BotFilter {
+		KalmanAxis x;
+		KalmanAxis y;
+		KalmanAxis w;
+		double timestamp = 0.0;
+		float height = 0.0f;
+		float confidence = 0.0f;
+		int age = 0; // 0: not tracked
+	};
+	/** Indexed by TrackingState id, only accessed by the receiver thread. */
+	std::array<BotFilter, 32> botFilters;
+	/** Latest t_capture of all received detection frames. */
+	double latestTimestamp = 0.0;
+
+	/*
+	 * The receiver thread is the only writer of the snapshots below: it builds a new immutable object and publishes it
+	 * with a Snapshot pointer store. Readers keep the snapshot alive by holding the shared_ptr, neither side waits for
+	 * the other to copy or process data.
+	 */
 
 	/** Increments each time the geometry has changed. */
 	int geometryVersion = 0;
-	/** Ball radius according to the geometry. */
-	float ballRadius = 21.5f;
+	/** receivedGeometryVersion at the last geometryCheck. */
+	int checkedGeometryVersion = 0;
 	/** Current geometry to be used by other tasks. */
-	SSL_GeometryData geometry;
-	/** Last received geometry, should only be accessed when having geometryMutex locked. */
-	SSL_GeometryData receivedGeometry;
-	std::mutex geometryMutex;
-
-	/** Currently tracked objects. Should only be accessed when having trackedMutex locked. */
-	std::map<unsigned int, std::vector<TrackingState>> trackedObjects;
-	std::mutex trackedMutex;
-
-	/** Time offsets measured relative to or reported by other cameras. Should only be accessed when having offsetMutex locked. */
-	std::vector<float> sentOffsets; // local.t_sent - other.time
-	std::vector<float> receivedOffsets; // other.t_sent - local.time
-	std::mutex offsetMutex;
+	std::shared_ptr<const SSL_GeometryData> geometry = std::make_shared<const SSL_GeometryData>();
+	/** Last received geometry. */
+	Snapshot<SSL_GeometryData> receivedGeometry{std::make_shared<const SSL_GeometryData>()};
+	/** Increments after each store to receivedGeometry. */
+	std::atomic<int> receivedGeometryVersion = 0;
+	/** Hash of the last received serialized geometry, only accessed by the receiver thread. */
+	size_t receivedGeometryHash = 0;
+	/** Ball radius according to the last received geometry, only accessed by the receiver thread. */
+	float ballRadius = 21.5f;
+
+	/** Currently tracked objects. */
+	Snapshot<TrackedObjects> trackedObjects{std::make_shared<const TrackedObjects>()};
+
+	Snapshot<TimeOffsets> timeOffsets{std::make_shared<const TimeOffsets>()};
+
+	/** Parsing arena of the receiver thread, reset for each packet. Its initial block covers a typical detection frame. */
+	alignas(8) char arenaBlock[32768];
+	google::protobuf::Arena arena;
 };
 
 /** Socket handling game controller messages. */
@@ -128,7 +232,7 @@ public:
 	double blueBotHeight;
 
 private:
-	void parse(char* data, int length) override;
+	void parse(char* data, int length, double receiveTime) override;
 
 	std::map<std::string, double> botHeights;
 };
\ No newline at end of file